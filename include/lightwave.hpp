@@ -14,6 +14,7 @@
 #include <lightwave/registry.hpp>
 
 // MARK: - utilities
+#include <lightwave/distribution.hpp>
 #include <lightwave/iterators.hpp>
 #include <lightwave/parallel.hpp>
 #include <lightwave/streaming.hpp>
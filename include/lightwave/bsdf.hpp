@@ -18,6 +18,10 @@ struct BsdfSample {
     /// @brief The weight of the sample, given by @code cos(theta) * B(wi, wo) /
     /// p(wi) @endcode
     Color weight;
+    /// @brief The solid angle density with which @c wi has been sampled, or
+    /// @c Infinity for specular events (which no other sampling technique can
+    /// reproduce).
+    float pdf;
 
     /// @brief Return an invalid sample, used to denote that sampling has
     /// failed.
@@ -25,9 +29,13 @@ struct BsdfSample {
         return {
             .wi     = Vector(0),
             .weight = Color(0),
+            .pdf    = 0,
         };
     }
 
+    /// @brief Tests whether the sample stems from a specular event.
+    bool isSpecular() const { return pdf == Infinity; }
+
     /// @brief Tests whether the sample is invalid (i.e., sampling has failed).
     bool isInvalid() const { return weight == Color(0); }
 };
@@ -73,6 +81,24 @@ public:
      * @param rng A random number generator used to steer the sampling.
      */
     virtual BsdfSample sample(const Point2 &uv, const Vector &wo, Sampler &rng) const = 0;
+    /**
+     * @brief Returns the solid angle density with which @ref sample
+     * generates a given direction in local coordinates (i.e., the normal is
+     * assumed to be [0,0,1]).
+     * @note Specular events are not included, as they cannot be generated
+     * by any other sampling technique.
+     * @param uv The texture coordinates of the surface.
+     * @param wo The outgoing direction light is scattered in, pointing away
+     * from the surface, in local coordinates.
+     * @param wi The incoming direction light comes from, pointing away
+     * from the surface, in local coordinates.
+     */
+    virtual float pdf(const Point2 &uv, const Vector &wo, const Vector &wi) const = 0;
+    /**
+     * @brief Returns whether the Bsdf only scatters light into discrete directions, i.e., whether all of its samples
+     * are specular and hence no other technique than @ref sample can produce directions for it.
+     */
+    virtual bool isSpecular() const { return false; }
 
     /**
      * @brief Samples the albedo for a particular uv.
@@ -75,6 +75,7 @@
 #include <ostream>
 #include <chrono>
 #include <string>
+#include <vector>
 
 #ifdef LW_CC_MSC
 #pragma warning(push)
@@ -147,6 +148,15 @@ class Executable : public Object {
 public:
     /// @brief Performs the action of this object when placed at the root of a scene file.
     virtual void execute() = 0;
+
+    /**
+     * @brief Returns the images this executable reads.
+     * Together with @ref outputs , this determines which executables depend on each other and which ones can run
+     * concurrently.
+     */
+    virtual std::vector<ref<Image>> inputs() const { return {}; }
+    /// @brief Returns the images this executable writes.
+    virtual std::vector<ref<Image>> outputs() const { return {}; }
 };
 
 /**
@@ -0,0 +1,210 @@
+/**
+ * @file distribution.hpp
+ * @brief Contains discrete distributions used to importance sample lights and geometry.
+ */
+
+#pragma once
+
+#include <lightwave/math.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace lightwave {
+
+/**
+ * @brief Samples indices proportionally to a list of non-negative weights in constant time, using Walker's alias
+ * method (in the formulation by Vose).
+ * Each of the n bins is chosen uniformly, and then either returns its own index or its alias, such that in total
+ * every index is returned with probability proportional to its weight.
+ * @note If all weights are zero, all indices are considered equally likely.
+ */
+class AliasTable {
+    struct Bin {
+        /// @brief The probability of returning the bin's own index once the bin has been picked.
+        float threshold;
+        /// @brief The index returned if the bin does not return its own index.
+        uint32_t alias;
+        /// @brief The normalized probability of the bin's own index being sampled.
+        float probability;
+    };
+
+    std::vector<Bin> m_bins;
+
+public:
+    AliasTable() {}
+
+    /// @brief Builds the table for the given weights, which must not be negative.
+    explicit AliasTable(const std::vector<float> &weights) {
+        const size_t n = weights.size();
+        m_bins.resize(n);
+        if (n == 0)
+            return;
+
+        double total = 0;
+        for (float weight : weights)
+            total += weight;
+
+        // bins are scaled such that the average bin holds a weight of exactly 1
+        std::vector<double> scaled(n);
+        std::vector<uint32_t> small, large;
+        for (size_t i = 0; i < n; i++) {
+            const double probability = total > 0 ? weights[i] / total : 1.0 / n;
+            m_bins[i].probability    = float(probability);
+            scaled[i]                = probability * n;
+            (scaled[i] < 1 ? small : large).push_back(uint32_t(i));
+        }
+
+        // fill up each bin that holds too little weight with the excess of a bin that holds too much
+        while (!small.empty() && !large.empty()) {
+            const uint32_t lesser  = small.back();
+            const uint32_t greater = large.back();
+            small.pop_back();
+            large.pop_back();
+
+            m_bins[lesser].threshold = float(scaled[lesser]);
+            m_bins[lesser].alias     = greater;
+
+            scaled[greater] -= 1 - scaled[lesser];
+            (scaled[greater] < 1 ? small : large).push_back(greater);
+        }
+
+        // the remaining bins are (up to rounding errors) exactly full
+        for (uint32_t i : small)
+            m_bins[i] = { 1, i, m_bins[i].probability };
+        for (uint32_t i : large)
+            m_bins[i] = { 1, i, m_bins[i].probability };
+    }
+
+    /// @brief Returns whether the table does not contain any entries.
+    bool empty() const { return m_bins.empty(); }
+    /// @brief Returns the number of entries of the table.
+    int size() const { return int(m_bins.size()); }
+
+    /// @brief Returns the probability of index @c i being sampled.
+    float probability(int i) const { return m_bins[i].probability; }
+
+    /// @brief Samples an index using a single uniform random number in [0,1).
+    int sample(float u) const {
+        const float scaled = u * m_bins.size();
+        const int bin      = std::min(int(scaled), int(m_bins.size()) - 1);
+        return scaled - bin < m_bins[bin].threshold ? bin : int(m_bins[bin].alias);
+    }
+};
+
+/**
+ * @brief A piecewise constant density over [0,1), given by a list of non-negative function values for equally sized
+ * intervals, which is sampled by inverting its cumulative distribution function.
+ * @note If all values are zero, the density is uniform.
+ */
+class Distribution1D {
+    std::vector<float> m_function;
+    /// @brief The normalized cumulative distribution function, with one more entry than there are intervals.
+    std::vector<float> m_cdf;
+    float m_integral;
+
+public:
+    Distribution1D() : m_integral(0) {}
+
+    explicit Distribution1D(std::vector<float> function) : m_function(std::move(function)) {
+        const int n = int(m_function.size());
+        m_cdf.resize(n + 1);
+
+        double sum = 0;
+        m_cdf[0] = 0;
+        for (int i = 0; i < n; i++) {
+            sum += m_function[i];
+            m_cdf[i + 1] = float(sum);
+        }
+        m_integral = float(sum / n);
+
+        if (sum == 0) {
+            for (int i = 1; i <= n; i++) m_cdf[i] = float(i) / n;
+        } else {
+            for (int i = 1; i <= n; i++) m_cdf[i] = float(m_cdf[i] / sum);
+        }
+    }
+
+    /// @brief Returns the number of intervals.
+    int size() const { return int(m_function.size()); }
+    /// @brief Returns the integral of the function over [0,1).
+    float integral() const { return m_integral; }
+
+    /// @brief Returns the density at a point in the given interval.
+    float pdf(int index) const {
+        return m_integral > 0 ? m_function[index] / m_integral : 1;
+    }
+
+    /**
+     * @brief Maps a uniform random number in [0,1) to a point in [0,1) distributed according to the density.
+     * @param pdf Receives the density at the sampled point.
+     * @param index Receives the interval the sampled point lies in.
+     */
+    float sample(float u, float &pdf, int &index) const {
+        // find the last interval whose cdf is not larger than u
+        index = int(std::upper_bound(m_cdf.begin(), m_cdf.end(), u) - m_cdf.begin()) - 1;
+        index = std::clamp(index, 0, size() - 1);
+        // skip intervals that cannot be sampled, which can be hit due to rounding
+        while (index < size() - 1 && m_cdf[index + 1] == m_cdf[index]) index++;
+
+        const float width = m_cdf[index + 1] - m_cdf[index];
+        const float offset = width > 0 ? std::clamp((u - m_cdf[index]) / width, 0.f, 1.f) : 0.5f;
+        pdf = this->pdf(index);
+
+        // keep the point within its interval despite rounding, so that looking up the density by position agrees
+        float x = std::min((index + offset) / size(), 0x1.fffffep-1f);
+        while (int(x * size()) > index) x = std::nextafter(x, 0.f);
+        while (int(x * size()) < index) x = std::nextafter(x, 1.f);
+        return x;
+    }
+};
+
+/**
+ * @brief A piecewise constant density over [0,1)^2, given by a grid of non-negative function values, which is sampled
+ * by first picking a row using the marginal density and then picking a point within the row using its conditional
+ * density.
+ */
+class Distribution2D {
+    std::vector<Distribution1D> m_conditional;
+    Distribution1D m_marginal;
+
+public:
+    Distribution2D() {}
+
+    /// @brief Builds the distribution from function values given in row-major order.
+    Distribution2D(const std::vector<float> &function, int width, int height) {
+        std::vector<float> rowIntegrals(height);
+        m_conditional.reserve(height);
+        for (int y = 0; y < height; y++) {
+            m_conditional.emplace_back(
+                std::vector<float>(function.begin() + size_t(y) * width, function.begin() + size_t(y + 1) * width));
+            rowIntegrals[y] = m_conditional.back().integral();
+        }
+        m_marginal = Distribution1D(std::move(rowIntegrals));
+    }
+
+    /**
+     * @brief Maps a uniform random point in [0,1)^2 to a point in [0,1)^2 distributed according to the density.
+     * @param pdf Receives the density at the sampled point.
+     */
+    Point2 sample(const Point2 &u, float &pdf) const {
+        float marginalPdf, conditionalPdf;
+        int row, column;
+        const float y = m_marginal.sample(u.y(), marginalPdf, row);
+        const float x = m_conditional[row].sample(u.x(), conditionalPdf, column);
+        pdf = marginalPdf * conditionalPdf;
+        return { x, y };
+    }
+
+    /// @brief Returns the density of sampling the given point in [0,1)^2.
+    float pdf(const Point2 &point) const {
+        const int height = m_marginal.size();
+        const int width = m_conditional.front().size();
+        const int row = std::clamp(int(point.y() * height), 0, height - 1);
+        const int column = std::clamp(int(point.x() * width), 0, width - 1);
+        return m_marginal.pdf(row) * m_conditional[row].pdf(column);
+    }
+};
+
+} // namespace lightwave
@@ -16,6 +16,22 @@ namespace lightwave {
 
 /// @brief An image.
 class Image final : public Object {
+public:
+    /// @brief The compression applied to EXR files.
+    enum class Compression {
+        None,
+        Zip,
+        Piz,
+    };
+
+    /// @brief How EXR files store their pixels.
+    struct SaveOptions {
+        Compression compression = Compression::Zip;
+        /// @brief Whether to store 16-bit half floats instead of 32-bit floats.
+        bool half = true;
+    };
+
+private:
     /// @brief The resolution of this image in pixels.
     Point2i m_resolution;
 
@@ -25,6 +41,13 @@ class Image final : public Object {
     /// @brief The folder the image was loaded from or should be stored to.
     std::filesystem::path m_basePath;
 
+    /// @brief Whether @ref save writes the image to disk.
+    bool m_save = true;
+    /// @brief Whether @ref m_save was given explicitly in the scene file.
+    bool m_saveSpecified = false;
+    /// @brief How the image is stored when it is saved.
+    SaveOptions m_saveOptions;
+
     /**
      * @brief Converts a normalized position from [0,0]..[+1,+1] to a pixel
      * index [0,0]..[resolution.x-1, resolution.y-1]. Input positions outside
@@ -50,6 +73,20 @@ public:
     Image(const Point2i &resolution) { initialize(resolution); }
 
     Image(const Properties &properties) {
+        m_saveSpecified = properties.has("save");
+        m_save = properties.get<bool>("save", true);
+        m_saveOptions.compression = properties.getEnum<Compression>(
+            "compression", Compression::Zip,
+            {
+                { "none", Compression::None },
+                { "zip", Compression::Zip },
+                { "piz", Compression::Piz },
+            });
+        m_saveOptions.half = properties.getEnum<bool>("pixelType", true,
+                                                      {
+                                                          { "half", true },
+                                                          { "float", false },
+                                                      });
         if (properties.has("filename")) {
             auto path = properties.get<std::filesystem::path>("filename");
             loadImage(path, properties.get<bool>("linear", false));
@@ -87,12 +124,36 @@ public:
         std::fill(m_data.begin(), m_data.end(), Color());
     }
 
-    /// @brief Saves the image as an EXR file at a given path.
+    /// @brief Saves the image as an EXR file at a given path, returning once
+    /// the file has been written.
     void saveAt(const std::filesystem::path &path) const;
 
-    /// @brief Saves the image at its default path, given by the @ref basePath
-    /// of this image and its @ref id .
-    void save() const { saveAt(m_basePath / (id() + ".exr")); }
+    /**
+     * @brief Saves the image at its default path, given by the @ref basePath
+     * of this image and its @ref id (unless it is an intermediate image).
+     * The pixels are copied and written by a background thread, so the image
+     * can be modified as soon as this returns.
+     * @see waitForPendingSaves
+     */
+    void save() const;
+
+    /// @brief Blocks until all images passed to @ref save have been written.
+    static void waitForPendingSaves();
+
+    /// @brief Sets how the image is stored when it is saved.
+    void setSaveOptions(const SaveOptions &options) { m_saveOptions = options; }
+
+    /**
+     * @brief Marks this image as an intermediate result that is only consumed
+     * by other executables, so that it is kept in memory instead of being
+     * saved (unless the scene file explicitly asks to save it).
+     */
+    void markIntermediate() {
+        if (!m_saveSpecified)
+            m_save = false;
+    }
+    /// @brief Whether this image is a final result that is written to disk.
+    bool isFinal() const { return m_save; }
 
     /// @brief Multiplies the color of all pixels component-wise by a given
     /// scalar.
@@ -34,6 +34,8 @@ class Instance : public Shape {
     ref<Texture> m_normal;
     /// @brief Flip the normal direction, used to correct for the change of handedness in case the transformation mirrors the object.
     bool m_flipNormal;
+    /// @brief Whether the transform only rotates, translates, uniformly scales or mirrors, which preserves solid angles.
+    bool m_preservesAngles;
     /// @brief The alpha texture (optional)
     ref<Texture> m_alpha;
     /// @brief Tracks whether this instance has been added to the scene, i.e., could be hit by ray tracing.
@@ -43,6 +45,13 @@ class Instance : public Shape {
     
     /// @brief Transforms the frame from object coordinates to world coordinates.
     inline void transformFrame(SurfaceEvent &surf) const;
+    /// @brief Computes the shading data of a hit reported by the wrapped shape, in object coordinates.
+    void completeChildHit(const Ray &localRay, Intersection &its) const;
+    /**
+     * @brief Intersects instances that may reject hits of the wrapped shape (due to alpha masking or volumes), which
+     * need their shading data right away and need to be able to restore the previous intersection.
+     */
+    bool intersectWithRejection(const Ray &worldRay, Intersection &its, Sampler &rng) const;
 
 public:
     Instance(const Properties &properties) 
@@ -61,6 +70,8 @@ public:
         if (m_transform && m_transform->determinant() < 0) {
             m_flipNormal = !m_flipNormal;
         }
+
+        m_preservesAngles = !m_transform || m_transform->isSimilarity();
     }
 
     /// @brief Returns the material that the shape should be rendered with (can be null for non-reflecting objects).
@@ -69,6 +80,12 @@ public:
     Emission *emission() const { return m_emission.get(); }
     /// @brief Returns the light object that contains this instance (or null if this instance is not part of any area light).
     Light *light() const { return m_light; }
+    /// @brief Returns the shape wrapped by the instance.
+    const Shape *shape() const { return m_shape.get(); }
+    /// @brief Returns the transformation from object coordinates to world coordinates (can be null for the identity).
+    const Transform *transform() const { return m_transform.get(); }
+    /// @brief Returns the volume inside the instance (can be null for instances without volumes).
+    const Volume *volume() const { return m_volume.get(); }
 
     /// @brief Returns whether this instance has been added to the scene, i.e., could be hit by ray tracing.
     bool isVisible() const { return m_visible; }
@@ -76,6 +93,10 @@ public:
     void markAsVisible() override {
         m_visible = true;
     }
+    /// @brief Adds this instance to the given list.
+    void collectInstances(std::vector<const Instance *> &instances) const override {
+        instances.push_back(this);
+    }
 
     /// @brief Sets the parent light object that contains this instance.
     void setLight(Light *light) {
@@ -93,6 +114,24 @@ public:
      * @return @c true if an intersection was found.
      */
     bool intersect(const Ray &ray, Intersection &its, Sampler &rng) const override;
+    /**
+     * @brief Computes the shading data of the closest hit in world coordinates, if the wrapped shape has deferred it.
+     * @note Call this once for the closest hit of a ray, i.e., when @c its.instance points to this instance.
+     */
+    void computeSurfaceInteraction(const Ray &ray, Intersection &its) const override;
+    /**
+     * @brief Tests whether the instance blocks a given ray in world coordinates anywhere closer than @c tMax .
+     * @note Instances with alpha masks or volumes need shading data or distance sampling to decide, and fall back to a
+     * full intersection.
+     */
+    bool occluded(const Ray &ray, float tMax, Sampler &rng) const override;
+    /**
+     * @brief Returns the fraction of light that passes through the instance along a ray in world coordinates up to
+     * @c tMax .
+     * @note Instances with volumes estimate the transmittance of their volume, while instances with alpha masks are
+     * treated like by @ref occluded .
+     */
+    float transmittance(const Ray &ray, float tMax, Sampler &rng) const override;
     /// @brief Returns the bounding box of the instance in world coordinates. 
     Bounds getBoundingBox() const override;
     /// @brief Returns the centroid of the instance in world coordinates. 
@@ -102,6 +141,17 @@ public:
      * @param rng A random number generator used to steer sampling decisions.
      */
     AreaSample sampleArea(Sampler &rng) const override;
+    /**
+     * @brief Samples a point in world coordinates on the surface of this instance by the solid angle it subtends.
+     * @note Uses the shape's solid angle sampling if the transform preserves angles, and falls back to area sampling
+     * otherwise.
+     * @param origin The point the instance is seen from, in world coordinates.
+     * @param rng A random number generator used to steer sampling decisions.
+     */
+    AreaSample sampleSolidAngle(const Point &origin, Sampler &rng) const override;
+    bool canSampleSolidAngle() const override { return true; }
+    /// @brief Returns the solid angle density of @ref sampleSolidAngle for a point on the surface in world coordinates.
+    float pdfSolidAngle(const Point &origin, const SurfaceEvent &surface) const override;
 
     /// @brief Returns a textual representation of this image.
     std::string toString() const override {
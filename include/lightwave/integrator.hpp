@@ -10,6 +10,9 @@
 #include <lightwave/math.hpp>
 #include <lightwave/sampler.hpp>
 #include <lightwave/image.hpp>
+#include <lightwave/instance.hpp>
+#include <lightwave/bsdf.hpp>
+#include <lightwave/parallel.hpp>
 #include <lightwave/scene.hpp>
 
 namespace lightwave {
@@ -23,6 +26,39 @@ namespace lightwave {
 class Integrator : public Executable {
 public:
     Integrator(const Properties &properties) {
+        // thread settings are applied while loading, since executables may run
+        // concurrently (unless they have been fixed on the command line)
+        if (properties.has("threads") || properties.has("pin")) {
+            ThreadPool::Settings settings;
+            settings.threads = properties.get<int>("threads", 0);
+            settings.pin = properties.get<bool>("pin", false);
+            ThreadPool::instance().configure(settings);
+        }
+    }
+};
+
+/**
+ * @brief Surface quantities at the first intersection of a camera ray, which
+ * are written to auxiliary output images (AOVs, e.g., to guide a denoiser).
+ * @note Camera rays that miss the scene leave all quantities at zero.
+ */
+struct FirstHit {
+    /// @brief The albedo of the BSDF at the intersection.
+    Color albedo;
+    /// @brief The shading normal at the intersection.
+    Vector normal;
+    /// @brief The distance from the camera to the intersection.
+    float depth = 0;
+
+    FirstHit() = default;
+    /// @brief Records the quantities of a camera ray intersection.
+    FirstHit(const Intersection &its) {
+        if (!its)
+            return;
+        if (its.instance->bsdf())
+            albedo = its.instance->bsdf()->albedo(its.uv);
+        normal = its.frame.normal;
+        depth = its.t;
     }
 };
 
@@ -38,12 +74,85 @@ protected:
     /// @brief The scene that should be rendered.
     ref<Scene> m_scene;
 
+    /// @brief Whether to render the whole image in passes of @ref m_passSamples
+    /// samples per pixel, instead of finishing one block after another.
+    bool m_progressive;
+    /// @brief The number of samples per pixel added by each progressive pass.
+    int m_passSamples;
+    /// @brief The wall-clock time in seconds after which progressive rendering
+    /// stops, even if the sampler's sample count has not been reached yet.
+    float m_timeBudget;
+    /// @brief Whether to stop sampling pixels once their estimate has
+    /// converged, and to spend the saved samples on the noisiest tiles.
+    bool m_adaptive;
+    /// @brief The relative standard error below which a pixel has converged.
+    float m_adaptiveThreshold;
+    /// @brief The number of samples every pixel receives before its error is
+    /// trusted.
+    int m_adaptiveMinSamples;
+    /// @brief Optional output image counting the samples taken per pixel.
+    ref<Image> m_sampleCountImage;
+    /// @brief Optional output image for the first-hit albedo.
+    ref<Image> m_albedoImage;
+    /// @brief Optional output image for the first-hit shading normal.
+    ref<Image> m_normalsImage;
+    /// @brief Optional output image for the first-hit distance (the depth
+    /// AOV, named "distance" since "depth" is the path length).
+    ref<Image> m_distanceImage;
+    /// @brief Whether normals are remapped from [-1,1] to [0,1] (matching the
+    /// "normals" integrator).
+    bool m_remapNormals;
+
+    /// @brief The running sums of all outputs of a pixel.
+    struct PixelSums {
+        Color color;
+        Color albedo;
+        Vector normal;
+        float depth = 0;
+    };
+
+    /// @brief Whether any of the first-hit output images is requested.
+    bool hasFirstHitImages() const {
+        return m_albedoImage || m_normalsImage || m_distanceImage;
+    }
+
+    /**
+     * @brief Computes one sample of the radiance arriving at a pixel, adds it
+     * (and the first-hit quantities, if requested) to @c sums and returns it.
+     */
+    Color samplePixel(const Point2i &pixel, int sample, Sampler &rng, PixelSums &sums);
+    /// @brief Writes the mean of @c count samples to all output images.
+    void writePixel(const Point2i &pixel, const PixelSums &sums, int count);
+    /// @brief Renders each block of the image to the full sample count.
+    void renderBlocks();
+    /// @brief Renders the whole image in passes, until either the sample
+    /// count or the time budget is reached.
+    void renderProgressive();
+    /// @brief Renders the image in passes that only revisit pixels that have
+    /// not converged yet, noisiest tiles first, until the total sample budget
+    /// of the sampler is spent.
+    void renderAdaptive();
+
 public:
     SamplingIntegrator(const Properties &properties)
     : Integrator(properties) {
         m_sampler = properties.getChild<Sampler>();
         m_image = properties.getOptionalChild<Image>();
         m_scene = properties.getChild<Scene>();
+
+        m_timeBudget = properties.get<float>("timeBudget", 0);
+        m_adaptive = properties.get<bool>("adaptive", false);
+        m_progressive = properties.get<bool>("progressive", m_timeBudget > 0 || m_adaptive);
+        m_passSamples = std::max(1, properties.get<int>("passSamples", m_adaptive ? 4 : 1));
+        m_adaptiveThreshold = properties.get<float>("adaptiveThreshold", 0.02f);
+        m_adaptiveMinSamples = std::max(2, properties.get<int>("adaptiveMinSamples", 16));
+        m_sampleCountImage = properties.get<Image>("sampleCount", nullptr);
+        m_albedoImage = properties.get<Image>("albedo", nullptr);
+        m_normalsImage = properties.get<Image>("normals", nullptr);
+        m_distanceImage = properties.get<Image>("distance", nullptr);
+        m_remapNormals = properties.get<bool>("remapNormals", true);
+        if (m_timeBudget <= 0)
+            m_timeBudget = Infinity;
     }
 
     /// @brief Sets the output image that should be populated by rendering.
@@ -58,6 +167,15 @@ public:
 
     /// @brief Computes all pixels of the image by constructing camera rays for them and invoking the @ref Li method.
     void execute() override;
+
+    std::vector<ref<Image>> outputs() const override {
+        std::vector<ref<Image>> result;
+        for (auto &image : { m_image, m_sampleCountImage, m_albedoImage, m_normalsImage, m_distanceImage }) {
+            if (image)
+                result.push_back(image);
+        }
+        return result;
+    }
     
     /**
      * @brief Returns (an estimate of) the incident radiance for a given ray.
@@ -66,6 +184,17 @@ public:
      * @ref execute function of the integrator.
      */
     virtual Color Li(const Ray &ray, Sampler &rng) = 0;
+    /**
+     * @brief Like @ref Li , but also reports the first intersection of the ray, which is used for the auxiliary
+     * output images (albedo, normals, depth) when they are requested.
+     * Integrators should override this to report the intersection they already compute; the default implementation
+     * traces the ray a second time.
+     */
+    virtual Color LiWithFirstHit(const Ray &ray, Sampler &rng, FirstHit &firstHit) {
+        const Color result = Li(ray, rng);
+        firstHit = FirstHit(m_scene->intersect(ray, rng));
+        return result;
+    }
 };
 
 }
@@ -19,6 +19,11 @@ struct DirectLightSample {
     Color weight;
     /// @brief The distance from the query point to the sampled point on the light source.
     float distance;
+    /**
+     * @brief The solid angle density with which @c wi has been sampled, or @c Infinity for lights that can only be
+     * reached by sampling them (e.g., point lights).
+     */
+    float pdf;
 
     /// @brief Return an invalid sample, used to denote that sampling has failed.
     static DirectLightSample invalid() {
@@ -26,6 +31,7 @@ struct DirectLightSample {
             .wi = Vector(),
             .weight = Color(),
             .distance = 0,
+            .pdf = 0,
         };
     }
 
@@ -51,6 +57,25 @@ public:
 
     /// @brief Returns whether this light source can be hit by rays (i.e., has an area that has been placed within the scene).
     virtual bool canBeIntersected() const { return false; }
+
+    /**
+     * @brief Returns the solid angle density with which @ref sampleDirect generates the point that a ray has hit.
+     * @note Only meaningful for lights that can be intersected, all other lights report zero.
+     * @param origin The light receiving point the ray started from.
+     * @param its The intersection of the ray with the light, or the escaped ray for lights at infinity.
+     */
+    virtual float pdf(const Point &origin, const Intersection &its) const { return 0; }
+
+    /**
+     * @brief Estimates the total power emitted by the light source, which is used to decide how often it is sampled.
+     * The estimate does not need to be exact, but lights that are brighter should report a larger power.
+     * @param sceneBounds The bounding box of the scene, needed to estimate the power of lights at infinity.
+     * @param rng A random number generator that can be used for Monte Carlo estimates.
+     */
+    virtual float power(const Bounds &sceneBounds, Sampler &rng) const = 0;
+
+    /// @brief Returns the region that light is emitted from, which is unbounded for lights at infinity.
+    virtual Bounds getBoundingBox() const { return Bounds::full(); }
 };
 
 /// @brief The result of evaluating a @ref BackgroundLight for a incident direction.
@@ -73,11 +98,22 @@ public:
      */
     virtual BackgroundLightEval evaluate(const Vector &direction) const = 0;
 
+    /**
+     * @brief Returns the solid angle density with which @ref sampleDirect generates a given direction, which allows
+     * combining light sampling with other sampling techniques.
+     * @param direction The direction in world coordinates, pointing away from the scene.
+     */
+    virtual float pdf(const Vector &direction) const { return 0; }
+
     DirectLightSample sampleDirect(const Point &origin, Sampler &rng) const override {
         return DirectLightSample::invalid();
     }
 
     bool canBeIntersected() const override { return true; }
+
+    float pdf(const Point &origin, const Intersection &its) const override {
+        return pdf(-its.wo);
+    }
 };
 
 }
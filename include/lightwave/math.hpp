@@ -762,6 +762,11 @@ struct SurfaceEvent {
     Point2 uv;
     /// @brief The shading frame of the surface at the given position.
     Frame frame;
+    /**
+     * @brief The normal of the underlying geometry (i.e., without interpolated normals or normal maps), which
+     * converts densities between area and solid angle.
+     */
+    Vector geometryNormal;
     /// @brief The probability of sampling the point when doing area sampling, in area units.
     float pdf;
     /// @brief The instance object associated with the surface.
@@ -783,6 +788,19 @@ struct Intersection : public SurfaceEvent {
         int primCounter = 0;
     } stats;
 
+    /**
+     * @brief A lightweight record of the hit for shapes that only compute shading data once the closest hit along a
+     * ray is known (see @ref Shape::computeSurfaceInteraction ).
+     */
+    struct {
+        /// @brief The shape whose shading data still needs to be computed, or null if the surface data is complete.
+        const Shape *shape = nullptr;
+        /// @brief The primitive of the shape that was hit.
+        int primitiveIndex = 0;
+        /// @brief The barycentric coordinates of the hit on the primitive.
+        Vector2 barycentrics;
+    } deferred;
+
     Intersection(const Vector &wo = Vector(), float t = Infinity)
     : wo(wo), t(t) {}
 
@@ -800,6 +818,8 @@ struct Intersection : public SurfaceEvent {
     BsdfSample sampleBsdf(Sampler &rng) const;
     /// @brief Evaluates the Bsdf of the underlying surface.
     BsdfEval evaluateBsdf(const Vector &wi) const;
+    /// @brief Returns the solid angle density of sampling the Bsdf of the underlying surface in a given direction.
+    float pdfBsdf(const Vector &wi) const;
 };
 
 /// @brief Print a given point to an output stream.
@@ -5,8 +5,18 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <compare>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include <lightwave/color.hpp>
 #include <lightwave/logger.hpp>
@@ -19,6 +29,258 @@
 
 namespace lightwave {
 
+/**
+ * @brief A process-wide pool of persistent worker threads with work stealing.
+ *
+ * Every worker owns a deque of tasks: it pushes and pops tasks at the back of
+ * its own deque (so nested work stays cache-local and depth-first), and steals
+ * tasks from the front of other deques once it runs out of work. Threads that
+ * are not part of the pool (e.g., the main thread) submit into a shared deque
+ * and help executing tasks while they wait (see @ref TaskGroup::wait ).
+ *
+ * The pool spawns one worker less than the configured number of threads the
+ * first time it is used, and keeps them alive until the process exits. Integrators, BVH
+ * builds, post-processes and asset loading should submit their work here
+ * (preferably through @ref TaskGroup or @ref parallel_for ) instead of
+ * spawning threads of their own, so that nested parallelism does not
+ * oversubscribe the machine.
+ */
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    /// @brief Controls how many threads the pool runs and where they run.
+    struct Settings {
+        /// @brief The number of threads executing tasks (including the
+        /// caller), or 0 to use every CPU the process may run on.
+        int threads = 0;
+        /**
+         * @brief Whether to pin every thread (including the caller of
+         * @ref configure ) to its own CPU. CPUs are handed out one NUMA node
+         * after another, so that smaller thread counts stay on as few sockets
+         * as possible.
+         * Pinning is what makes NUMA placement work: only then are tasks
+         * submitted to a node (see @ref submit ) guaranteed to run on it, and
+         * memory they first touch (e.g., the per-tile buffers of integrators)
+         * ends up local to it.
+         * @note Buffers allocated before the work is distributed (e.g., the
+         * images integrators render into and acceleration structures) still
+         * end up on the node of the thread that allocates them.
+         */
+        bool pin = false;
+
+        auto operator<=>(const Settings &) const = default;
+    };
+
+    /// @brief Returns the pool shared by the whole process.
+    static ThreadPool &instance();
+
+    ThreadPool(const ThreadPool &)            = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ~ThreadPool();
+
+    /**
+     * @brief Restarts the workers with the given settings.
+     * Settings passed with @c fix (i.e., command line options) take precedence
+     * over later calls without it (i.e., options from scene files).
+     * @warning Aborts if the settings change while a @ref TaskGroup exists.
+     */
+    void configure(const Settings &settings, bool fix = false);
+    /// @brief The settings the workers currently run with.
+    const Settings &settings() const { return m_settings; }
+
+    /// @brief The number of threads executing tasks, including the caller.
+    int numberOfThreads() const { return int(m_workers.size()) + 1; }
+    /// @brief The number of NUMA nodes the workers are spread across.
+    int numberOfNodes() const { return m_numNodes; }
+
+    /**
+     * @brief Enqueues a task, which will be run by some thread of the pool.
+     * @param node The NUMA node (in [0, @ref numberOfNodes )) whose workers
+     * should run the task, which spreads tasks across the queues of that
+     * node. Workers of other nodes only steal them once their own node has
+     * run out of work. Pass -1 to enqueue into the queue of the calling
+     * thread instead.
+     */
+    void submit(Task task, int node = -1);
+    /**
+     * @brief Runs a single pending task on the calling thread, if any.
+     * @return Whether a task was run.
+     */
+    bool runPendingTask();
+
+private:
+    friend class TaskGroup;
+
+    /// @brief A deque of tasks, guarded by its own lock.
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    ThreadPool();
+
+    void start();
+    void stop();
+
+    /// @brief Appends a task to the given queue and wakes up a worker.
+    void push(int index, Task task);
+    /// @brief The main loop of a worker thread.
+    void work(int index);
+    /// @brief Takes a task from the own queue, or steals one from others.
+    bool takeTask(int index, Task &task);
+
+    Settings m_settings;
+    bool m_fixed = false;
+    int m_numNodes = 1;
+    /// @brief Whether the thread that last started the pool has been pinned.
+    bool m_pinnedCaller = false;
+    /// @brief The number of task groups that currently exist.
+    std::atomic<int> m_activeGroups{ 0 };
+
+    /// @brief One queue per worker, followed by the queue shared by all
+    /// threads outside of the pool.
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    /// @brief The order in which each thread visits queues when looking for
+    /// work: its own queue, then queues of the same NUMA node, then others.
+    std::vector<std::vector<int>> m_victims;
+    /// @brief The queues of the workers on each NUMA node.
+    std::vector<std::vector<int>> m_nodeQueues;
+    /// @brief Counts the tasks submitted to each node, to distribute them
+    /// round-robin across its queues.
+    std::unique_ptr<std::atomic<unsigned>[]> m_nodeSubmissions;
+    std::vector<std::thread> m_workers;
+
+    /// @brief Number of tasks that have been submitted but not taken yet.
+    std::atomic<int> m_pending{ 0 };
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeUp;
+    bool m_stop = false;
+};
+
+/// @brief Returns the number of threads that @ref ThreadPool distributes work
+/// across (including the thread that waits for the work to finish).
+inline int numberOfThreads() { return ThreadPool::instance().numberOfThreads(); }
+
+/**
+ * @brief A set of tasks executed by the @ref ThreadPool that can be waited
+ * for. Tasks may themselves spawn task groups and wait for them.
+ * @note Exceptions thrown by tasks are rethrown by @ref wait (if multiple
+ * tasks fail, only the first exception is kept).
+ */
+class TaskGroup {
+public:
+    TaskGroup() : m_pool(ThreadPool::instance()) { m_pool.m_activeGroups++; }
+    TaskGroup(const TaskGroup &)            = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+    ~TaskGroup() {
+        waitForTasks();
+        m_pool.m_activeGroups--;
+    }
+
+    /// @brief Submits @c f to the pool as part of this group, optionally to
+    /// the workers of a given NUMA node (see @ref ThreadPool::submit ).
+    template <typename Function> void run(Function &&f, int node = -1) {
+        m_running++;
+        m_pool.submit(
+            [this, f = std::forward<Function>(f)]() mutable {
+                try {
+                    f();
+                } catch (...) {
+                    std::lock_guard lock(m_exceptionMutex);
+                    if (!m_exception)
+                        m_exception = std::current_exception();
+                }
+                m_running--;
+            },
+            node);
+    }
+
+    /// @brief Blocks until all tasks of this group have finished, helping to
+    /// execute pending tasks in the meantime.
+    void wait() {
+        waitForTasks();
+        if (m_exception)
+            std::rethrow_exception(std::exchange(m_exception, nullptr));
+    }
+
+private:
+    void waitForTasks() {
+        while (m_running > 0) {
+            if (!m_pool.runPendingTask())
+                std::this_thread::yield();
+        }
+    }
+
+    ThreadPool &m_pool;
+    std::atomic<int> m_running{ 0 };
+    std::mutex m_exceptionMutex;
+    std::exception_ptr m_exception;
+};
+
+/**
+ * @brief Invokes @c f for every index in [begin, end), parallelized across
+ * all threads of the @ref ThreadPool . Indices are claimed dynamically in
+ * increasing order, so expensive items at the front balance well.
+ */
+template <typename Function>
+void parallel_for(int begin, int end, Function f) {
+    const int numThreads =
+        std::min(ThreadPool::instance().numberOfThreads(), end - begin);
+    if (numThreads <= 1) {
+        for (int i = begin; i < end; i++)
+            f(i);
+        return;
+    }
+
+    std::atomic<int> next{ begin };
+    const auto loop = [&]() {
+        for (int i; (i = next++) < end;)
+            f(i);
+    };
+
+    TaskGroup group;
+    for (int thread = 1; thread < numThreads; thread++)
+        group.run(loop);
+
+    try {
+        loop();
+    } catch (...) {
+        // let the other threads run dry before unwinding the loop state
+        next = end;
+        group.wait();
+        throw;
+    }
+    group.wait();
+}
+
+/**
+ * @brief Invokes @c f for every index in [begin, end), roughly in increasing
+ * order, where each index is run by the workers of the NUMA node that @c node
+ * returns for it (in [0, number of nodes)). Nodes that run out of work steal
+ * from others. Memory that @c f first touches thus ends up on the node the
+ * index belongs to, so indices that access the same data should map to the
+ * same node.
+ * @note Only differs from @ref parallel_for if threads are pinned and spread
+ * across multiple NUMA nodes, since nodes are meaningless otherwise.
+ */
+template <typename NodeFunction, typename Function>
+void parallel_for_nodes(int begin, int end, NodeFunction node, Function f) {
+    auto &pool = ThreadPool::instance();
+    if (!pool.settings().pin || pool.numberOfNodes() <= 1) {
+        parallel_for(begin, end, f);
+        return;
+    }
+
+    // one task per index, since they cannot be claimed from a shared counter
+    // without losing track of their nodes (submitted back to front, since
+    // workers run the most recent task of their own queue first)
+    TaskGroup group;
+    for (int i = end - 1; i >= begin; i--)
+        group.run([&f, i]() { f(i); }, node(i));
+    group.wait();
+}
+
 /// @brief Invokes @c f for each element of the iterator, parallelized across
 /// all available cores.
 template <class ForwardIt, class UnaryFunction>
@@ -28,37 +290,12 @@ void for_each_parallel(ForwardIt first, ForwardIt last, UnaryFunction f) {
     return;
 #endif
 
-    std::mutex m_lock;
-
-    const int numThreads = std::thread::hardware_concurrency();
-    std::vector<std::thread> m_threads;
-    m_threads.reserve(numThreads);
-
-    // build a thread pool
-    for (int i = 0; i < numThreads; i++) {
-        m_threads.emplace_back([&]() {
-            while (true) {
-                m_lock.lock();
-                if (!(first != last)) {
-                    // no more work to do
-                    m_lock.unlock();
-                    break;
-                }
-
-                // grab a work item
-                auto obj = *first;
-                ++first;
-                m_lock.unlock();
-
-                // execute the work item
-                f(obj);
-            }
-        });
-    }
+    // gather the work items, so that threads can claim them without locking
+    std::vector<std::decay_t<decltype(*first)>> items;
+    for (; first != last; ++first)
+        items.push_back(*first);
 
-    // wait until all threads have finished
-    for (auto &thread : m_threads)
-        thread.join();
+    parallel_for(0, int(items.size()), [&](int i) { f(items[i]); });
 }
 
 /// @brief Invokes @c f for each element of the iterator, parallelized across
@@ -9,6 +9,7 @@
 #include <lightwave/color.hpp>
 #include <lightwave/math.hpp>
 #include <lightwave/image.hpp>
+#include <lightwave/streaming.hpp>
 
 namespace lightwave {
 
@@ -22,11 +23,27 @@ protected:
     /// @brief The output image that will be produced.
     ref<Image> m_output;
 
+    /**
+     * @brief Saves the output image and sends it to the image viewer, unless
+     * it is an intermediate image that only feeds other executables.
+     */
+    void publishOutput() {
+        if (!m_output->isFinal())
+            return;
+
+        m_output->save();
+        Streaming stream { *m_output };
+        stream.update();
+    }
+
 public:
     Postprocess(const Properties &properties) {
         m_input = properties.get<Image>("input");
         m_output = properties.getChild<Image>();
     }
+
+    std::vector<ref<Image>> inputs() const override { return { m_input }; }
+    std::vector<ref<Image>> outputs() const override { return { m_output }; }
 };
 
 }
@@ -6,16 +6,33 @@
 #pragma once
 
 #include <lightwave/core.hpp>
+#include <lightwave/distribution.hpp>
 #include <vector>
+#include <unordered_map>
 
 namespace lightwave {
 
+class LightBVH;
+
 /// @brief The result of asking the scene to pick a random light source using @ref Scene::sampleLight .
 struct LightSample {
     /// @brief The light source that has been picked.
     const Light *light;
     /// @brief The probability of this light source having been picked.
     float probability;
+
+    /// @brief Return an invalid sample, used to denote that no light could be picked.
+    static LightSample invalid() {
+        return {
+            .light = nullptr,
+            .probability = 0,
+        };
+    }
+
+    /// @brief Tests whether the sample is invalid (i.e., no light could be picked).
+    bool isInvalid() const {
+        return light == nullptr;
+    }
 };
 
 /// @brief Scenes are the input to rendering algorithms: They contain all geometry, materials, lights and the camera.
@@ -32,6 +49,33 @@ class Scene : public Object {
      */
     std::vector<ref<Light>> m_lights;
 
+    /// @brief How lights are picked for next event estimation.
+    enum class LightSelection {
+        /// @brief Every light is equally likely.
+        Uniform,
+        /// @brief Lights are picked proportionally to their estimated power.
+        Power,
+        /// @brief Lights are picked by their estimated contribution to the shading point using a @ref LightBVH .
+        Hierarchy,
+    };
+    LightSelection m_lightSelection;
+    /// @brief Picks from all lights by their estimated power (or uniformly, for @ref LightSelection::Uniform ).
+    AliasTable m_lightTable;
+    /// @brief For @ref LightSelection::Hierarchy , the hierarchy over all lights with finite extent.
+    ref<LightBVH> m_lightHierarchy;
+    /// @brief For @ref LightSelection::Hierarchy , picks from all lights at infinity by their estimated power.
+    AliasTable m_infiniteLightTable;
+    /// @brief For @ref LightSelection::Hierarchy , the probability of picking from the hierarchy instead of the lights
+    /// at infinity.
+    float m_hierarchyProbability;
+    /// @brief For @ref LightSelection::Hierarchy , the lights that can be picked from the hierarchy or at infinity.
+    std::vector<const Light *> m_finiteLights, m_infiniteLights;
+    /// @brief Maps each light to its index in @ref m_lights and in @ref m_finiteLights or @ref m_infiniteLights .
+    std::unordered_map<const Light *, std::pair<int, int>> m_lightIndices;
+
+    /// @brief Builds the light selection structures once all lights and geometry are known.
+    void buildLightSelection();
+
 public:
     Scene(const Properties &properties);
     std::string toString() const override;
@@ -43,17 +87,29 @@ public:
     Intersection intersect(const Ray &ray, Sampler &rng) const;
     /// @brief Reports whether any intersection up to a given maximal distance exists (used for testing visibility of light sources).
     bool intersect(const Ray &ray, float tMax, Sampler &rng) const;
+    /// @brief Returns the fraction of light that reaches a given maximal distance along a ray (used for shadow rays through participating media).
+    float transmittance(const Ray &ray, float tMax, Sampler &rng) const;
     /// @brief Evaluates the background illumination for a given direction pointing away from the scene.
     BackgroundLightEval evaluateBackground(const Vector &direction) const;
 
     /// @brief Reports whether at least one light exists that could be sampled.
     bool hasLights() const { return !m_lights.empty(); }
+    /// @brief Returns all lights that can be sampled.
+    const std::vector<ref<Light>> &lights() const { return m_lights; }
+    /// @brief Returns all instances that make up the scene geometry.
+    std::vector<const Instance *> instances() const;
     /// @brief Reports whether a background light exists. 
     bool hasBackground() const { return m_background != nullptr; }
-    /// @brief Randomly picks a light from the list of sampleable light sources. 
+    /// @brief Returns the background light (or null if there is none).
+    const BackgroundLight *background() const { return m_background.get(); }
+    /// @brief Randomly picks a light from the list of sampleable light sources, without knowledge of the shading point.
     LightSample sampleLight(Sampler &rng) const;
+    /// @brief Randomly picks a light from the list of sampleable light sources that is likely to illuminate @c origin .
+    LightSample sampleLight(const Point &origin, Sampler &rng) const;
     /// @brief Returns the probability of randomly picking a light source via @ref sampleLight .
     float lightSelectionProbability(const Light *light) const;
+    /// @brief Returns the probability of randomly picking a light source for a given shading point via @ref sampleLight .
+    float lightSelectionProbability(const Light *light, const Point &origin) const;
     /// @brief Returns the bounding box of the scene geometry.
     Bounds getBoundingBox() const;
 };
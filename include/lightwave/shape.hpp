@@ -36,6 +36,29 @@ public:
      * @note Intersections farther away than the previous value of @c its.t will be dismissed.
      */
     virtual bool intersect(const Ray &ray, Intersection &its, Sampler &rng) const = 0;
+    /**
+     * @brief Tests whether the shape blocks the ray anywhere closer than @c tMax (e.g., for shadow rays).
+     * Since any intersection suffices, shapes can stop at the first hit they find and skip computing shading data.
+     * The default implementation falls back to a full @ref intersect call.
+     */
+    virtual bool occluded(const Ray &ray, float tMax, Sampler &rng) const {
+        Intersection its(-ray.direction, tMax);
+        return intersect(ray, its, rng);
+    }
+    /**
+     * @brief Returns the fraction of light that passes through the shape along the ray up to @c tMax (e.g., for
+     * shadow rays through participating media).
+     * The default implementation treats the shape as opaque, i.e., returns either zero or one based on @ref occluded .
+     */
+    virtual float transmittance(const Ray &ray, float tMax, Sampler &rng) const {
+        return occluded(ray, tMax, rng) ? 0.f : 1.f;
+    }
+    /**
+     * @brief Computes the shading data of a hit whose computation has been deferred by this shape, i.e., for which
+     * @c its.deferred.shape points to this shape.
+     * @param ray The ray that was used to find the intersection, in the coordinate system of the shape.
+     */
+    virtual void computeSurfaceInteraction(const Ray &ray, Intersection &its) const {}
     /// @brief Returns a bounding box that tightly encapsulates the shape. 
     virtual Bounds getBoundingBox() const = 0;
     /**
@@ -50,12 +73,45 @@ public:
         NOT_IMPLEMENTED
     }
 
+    /// @brief Reports whether the shape implements @ref sampleSolidAngle (otherwise, lights sample it by area).
+    virtual bool canSampleSolidAngle() const { return false; }
+    /**
+     * @brief Samples a random point on the surface of this shape proportionally to the solid angle it subtends as
+     * seen from a given point, which avoids wasting samples on parts of the shape that face away from that point.
+     * @note The @c pdf of the resulting sample is given in solid angle as seen from @c origin .
+     * @param origin The point the shape is seen from, in the coordinate system of the shape.
+     * @param rng A random number generator used to steer the sampling.
+     */
+    virtual AreaSample sampleSolidAngle(const Point &origin, Sampler &rng) const {
+        NOT_IMPLEMENTED
+    }
+    /**
+     * @brief Returns the solid angle density with which @ref sampleSolidAngle generates a given point on the surface.
+     * @param origin The point the shape is seen from, in the coordinate system of the shape.
+     * @param surface The point on the surface of the shape, in the coordinate system of the shape.
+     */
+    virtual float pdfSolidAngle(const Point &origin, const SurfaceEvent &surface) const {
+        NOT_IMPLEMENTED
+    }
+
     /**
      * @brief Marks that the shape is part of the scene geometry, i.e., can be hit through @ref Scene::intersect .
      * @example A shape that is added to an area light could be invisible to ray tracing, if it is not also added to the scene
      * using a reference.
      */
     virtual void markAsVisible() {}
+    /// @brief Adds all instances within the shape to the given list (instances nested within other instances are not included).
+    virtual void collectInstances(std::vector<const Instance *> &instances) const {}
+
+protected:
+    /// @brief Converts a density with respect to surface area into a density with respect to solid angle.
+    static float areaToSolidAngle(float pdf, const Point &origin, const SurfaceEvent &surface) {
+        const Vector toOrigin = origin - surface.position;
+        const float distanceSquared = toOrigin.lengthSquared();
+        const float cosTheta = std::abs(surface.geometryNormal.dot(toOrigin)) / std::sqrt(distanceSquared);
+        if (cosTheta == 0 || distanceSquared == 0) return 0;
+        return pdf * distanceSquared / cosTheta;
+    }
 };
 
 }
@@ -178,6 +178,23 @@ public:
         return m_transform.submatrix<3, 3>(0, 0).determinant();
     }
 
+    /**
+     * @brief Returns whether this transformation only rotates, translates, uniformly scales or mirrors, i.e., whether
+     * it preserves angles (and hence solid angles).
+     */
+    bool isSimilarity() const {
+        const Vector x = apply(Vector(1, 0, 0));
+        const Vector y = apply(Vector(0, 1, 0));
+        const Vector z = apply(Vector(0, 0, 1));
+        const float scale = x.lengthSquared();
+        const float tolerance = 1e-4f * scale;
+        return std::abs(y.lengthSquared() - scale) <= tolerance &&
+               std::abs(z.lengthSquared() - scale) <= tolerance &&
+               std::abs(x.dot(y)) <= tolerance &&
+               std::abs(x.dot(z)) <= tolerance &&
+               std::abs(y.dot(z)) <= tolerance;
+    }
+
     std::string toString() const override {
         return tfm::format(
             "Transform[\n"
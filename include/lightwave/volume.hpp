@@ -4,8 +4,114 @@
 #include <lightwave/math.hpp>
 #include <lightwave/sampler.hpp>
 
+#include <vector>
+
 namespace lightwave {
 
+/**
+ * @brief A coarse grid of macro-cells over the local space of a volume, each of which stores bounds of the density
+ * within it, so that tracking can use tight local majorants and skip empty space altogether.
+ * @note The density is assumed to be zero outside of the bounds of the grid.
+ */
+class MajorantGrid {
+public:
+    /// @brief The bounds of the density within a macro-cell.
+    struct Cell {
+        float minDensity;
+        float maxDensity;
+    };
+
+    MajorantGrid(const Bounds &bounds, const Vector3i &resolution)
+        : m_bounds(bounds), m_resolution(resolution),
+          m_cells(size_t(resolution.x()) * resolution.y() * resolution.z(), Cell { 0, 0 }) {}
+
+    /// @brief Returns the number of macro-cells along each axis.
+    const Vector3i &resolution() const { return m_resolution; }
+    /// @brief Returns the region of local space covered by the macro-cell with the given index.
+    Bounds cellBounds(int x, int y, int z) const {
+        const Vector size = cellSize();
+        const Point min = m_bounds.min() + Vector(x * size.x(), y * size.y(), z * size.z());
+        return Bounds(min, min + size);
+    }
+
+    Cell &cell(int x, int y, int z) { return m_cells[index(x, y, z)]; }
+    const Cell &cell(int x, int y, int z) const { return m_cells[index(x, y, z)]; }
+
+    /**
+     * @brief Walks along a segment of a (normalized) ray through all macro-cells it passes with a 3D-DDA (Amanatides
+     * and Woo, "A Fast Voxel Traversal Algorithm for Ray Tracing"), skipping cells in which the density vanishes.
+     * @param callback Called as @code callback(t0, t1, minDensity, maxDensity) @endcode for the part of the segment
+     * within each non-empty cell, in order along the ray, and returns whether the traversal should continue.
+     */
+    template <typename Callback>
+    void traverse(const Ray &ray, float tStart, float tEnd, Callback &&callback) const {
+        // clip the segment to the bounds of the grid
+        for (int dim = 0; dim < 3; dim++) {
+            if (ray.direction[dim] == 0) {
+                if (ray.origin[dim] < m_bounds.min()[dim] || ray.origin[dim] > m_bounds.max()[dim]) return;
+                continue;
+            }
+            float tNear = (m_bounds.min()[dim] - ray.origin[dim]) / ray.direction[dim];
+            float tFar = (m_bounds.max()[dim] - ray.origin[dim]) / ray.direction[dim];
+            if (tNear > tFar) std::swap(tNear, tFar);
+            tStart = std::max(tStart, tNear);
+            tEnd = std::min(tEnd, tFar);
+        }
+        if (!(tStart < tEnd)) return;
+
+        const Vector size = cellSize();
+        const Point entry = ray(tStart);
+        int cell[3], step[3];
+        float nextT[3], deltaT[3];
+        for (int dim = 0; dim < 3; dim++) {
+            cell[dim] = std::clamp(int((entry[dim] - m_bounds.min()[dim]) / size[dim]), 0, m_resolution[dim] - 1);
+            if (ray.direction[dim] == 0) {
+                step[dim] = 0;
+                nextT[dim] = Infinity;
+                deltaT[dim] = Infinity;
+                continue;
+            }
+            step[dim] = ray.direction[dim] > 0 ? 1 : -1;
+            const float plane = m_bounds.min()[dim] + (cell[dim] + (step[dim] > 0 ? 1 : 0)) * size[dim];
+            nextT[dim] = (plane - ray.origin[dim]) / ray.direction[dim];
+            deltaT[dim] = size[dim] / std::abs(ray.direction[dim]);
+        }
+
+        float t = tStart;
+        while (true) {
+            int axis = 0;
+            if (nextT[1] < nextT[axis]) axis = 1;
+            if (nextT[2] < nextT[axis]) axis = 2;
+
+            const float tExit = std::min(nextT[axis], tEnd);
+            const Cell &current = this->cell(cell[0], cell[1], cell[2]);
+            if (tExit > t && current.maxDensity > 0) {
+                if (!callback(t, tExit, current.minDensity, current.maxDensity)) return;
+            }
+            if (nextT[axis] >= tEnd) return;
+
+            t = nextT[axis];
+            cell[axis] += step[axis];
+            if (cell[axis] < 0 || cell[axis] >= m_resolution[axis]) return;
+            nextT[axis] += deltaT[axis];
+        }
+    }
+
+private:
+    Bounds m_bounds;
+    Vector3i m_resolution;
+    std::vector<Cell> m_cells;
+
+    Vector cellSize() const {
+        const Vector diagonal = m_bounds.diagonal();
+        return Vector(diagonal.x() / m_resolution.x(), diagonal.y() / m_resolution.y(),
+                      diagonal.z() / m_resolution.z());
+    }
+    size_t index(int x, int y, int z) const {
+        return (size_t(z) * m_resolution.y() + y) * m_resolution.x() + x;
+    }
+};
+
 /// @brief Models a grid of volumetric densities
 class Volume : public Object {
 public:
@@ -14,43 +120,107 @@ public:
      */
     virtual float evaluate(const Point &pos) const = 0;
     virtual float getMaxDensity() const = 0;
+    /**
+     * @brief Returns a lower bound of the density, which is used as control density for residual ratio tracking
+     * (zero is always a valid choice).
+     */
+    virtual float getMinDensity() const { return 0; }
+    /**
+     * @brief Returns local bounds of the density that tracking should use instead of the global ones, or null if the
+     * volume does not provide any.
+     */
+    virtual const MajorantGrid *getMajorantGrid() const { return nullptr; }
+
+    /// @brief The maximum number of tracking steps before a ray is considered to be stuck in the volume.
+    static constexpr int TRACKING_STEPS = 1024;
+
     bool sampleDistance(float itsT, float insideT, float scaleFactor,
         const Ray &localRay, Sampler &rng, float &distance) const
     {
-        const int TRACKING_STEPS = 1024;
-        const float maxDensity = getMaxDensity();
-        for (int i = 0; i < TRACKING_STEPS; i++) {
-            const float sigmaT = maxDensity;
-
-            const float e = rng.next();
-            // Sample random distance in local space
-            const float sampleT = -log(1 - e) / sigmaT * scaleFactor;
-
-            if (sampleT < insideT) {
-                // Sampled a point inside the volume
-                const float nextT = itsT + sampleT; // Distance to sampled point along localRay 
-                const Point localPoint = localRay(nextT);
-                const float realProbability = evaluate(localPoint) / maxDensity;
-
-                if (rng.next() < realProbability) {
-                    // Convert nextT back to world space
-                    distance = nextT / scaleFactor;
+        bool collided = false;
+        int steps = 0;
+        traverseMajorants(localRay, itsT, itsT + insideT, [&](float t0, float t1, float, float maxDensity) {
+            float t = t0;
+            while (true) {
+                // Sample random distance in local space
+                t -= std::log(1 - rng.next()) / maxDensity * scaleFactor;
+                if (t >= t1) {
+                    // Left the segment without a collision, continue with the next one
                     return true;
-                } else {
-                    // We hit a null particle, continue tracking
-                    itsT = nextT; // itsT is increased by sampleT
-                    insideT -= sampleT; // Less inside distance left (we stepped by sampleT)
-                    continue;
                 }
-            } else {
-                // Ignore intersection, sampeld outside of volume
-                return false;
+
+                const float realProbability = evaluate(localRay(t)) / maxDensity;
+                if (++steps >= TRACKING_STEPS || rng.next() < realProbability) {
+                    // Sampled a real collision (or ran out of tracking steps, the volume is too dense)
+                    // Convert t back to world space
+                    distance = t / scaleFactor;
+                    collided = true;
+                    return false;
+                }
+                // We hit a null particle, continue tracking
             }
-        }
+        });
+        return collided;
+    }
 
-        // Not sure what to do here, ran out of tracking steps, volume too dense
-        distance = itsT / scaleFactor;
-        return true;
+    /**
+     * @brief Estimates the fraction of light that passes through the volume along a segment of a ray.
+     * The default implementation uses residual ratio tracking (Novak et al. 2014): the transmittance of the control
+     * density @ref getMinDensity is known in closed form, and only the residual density is tracked, with every
+     * tentative collision weighting the estimate by the probability of it being a null collision instead of
+     * terminating the ray.
+     * @param localRay The normalized ray in the local space of the volume.
+     * @param tStart The distance along the ray (local space) at which the segment starts.
+     * @param tEnd The distance along the ray (local space) at which the segment ends.
+     * @param scaleFactor The ratio of local to world space distances, since densities are given per world unit.
+     */
+    virtual float transmittance(const Ray &localRay, float tStart, float tEnd, float scaleFactor, Sampler &rng) const {
+        float result = 1;
+        int steps = 0;
+        traverseMajorants(localRay, tStart, tEnd, [&](float t0, float t1, float controlDensity, float maxDensity) {
+            result *= std::exp(-controlDensity * (t1 - t0) / scaleFactor);
+            const float residualMajorant = maxDensity - controlDensity;
+            if (residualMajorant <= 0) return true;
+
+            float t = t0;
+            while (true) {
+                t -= std::log(1 - rng.next()) / residualMajorant * scaleFactor;
+                if (t >= t1) return true;
+
+                if (++steps >= TRACKING_STEPS) {
+                    // ran out of tracking steps, the volume is too dense to let any light through
+                    result = 0;
+                    return false;
+                }
+                result *= 1 - (evaluate(localRay(t)) - controlDensity) / residualMajorant;
+
+                // Russian roulette keeps rays through dense media from tracking all the way through
+                if (result < 0.05f) {
+                    if (rng.next() < 0.75f) {
+                        result = 0;
+                        return false;
+                    }
+                    result /= 0.25f;
+                }
+            }
+        });
+        return result;
+    }
+
+protected:
+    /**
+     * @brief Splits a segment of a ray into parts with known bounds of the density, i.e., the macro-cells of
+     * @ref getMajorantGrid if available, or otherwise the whole segment with the global bounds.
+     * @see MajorantGrid::traverse
+     */
+    template <typename Callback>
+    void traverseMajorants(const Ray &localRay, float tStart, float tEnd, Callback &&callback) const {
+        if (const MajorantGrid *grid = getMajorantGrid()) {
+            grid->traverse(localRay, tStart, tEnd, callback);
+            return;
+        }
+        const float maxDensity = getMaxDensity();
+        if (maxDensity > 0 && tStart < tEnd) callback(tStart, tEnd, getMinDensity(), maxDensity);
     }
 };
 
@@ -48,6 +48,16 @@ inline Vector squareToUniformSphere(const Point2 &sample) {
     return { r * cosPhi, r * sinPhi, z };
 }
 
+/// @brief The inverse of @ref squareToUniformSphere , mapping a unit direction back to the unit square.
+inline Point2 uniformSphereToSquare(const Vector &direction) {
+    float phi = std::atan2(direction.y(), direction.x());
+    if (phi < 0) phi += 2 * Pi;
+    return {
+        std::clamp(phi * Inv2Pi, 0.f, 1.f),
+        std::clamp((1 - direction.z()) / 2, 0.f, 1.f),
+    };
+}
+
 /**
  * @brief Warps a given point from the unit square ([0,0] to [1,1]) to a unit hemisphere (centered around [0,0,0] with radius 1,
  * pointing in z direction), with respect to solid angle.
@@ -79,4 +89,13 @@ inline float cosineHemispherePdf(const Vector &vector) {
     return InvPi * std::max(vector.z(), float(0));
 }
 
+/**
+ * @brief Warps a given point from the unit square ([0,0] to [1,1]) to barycentric coordinates that are uniformly
+ * distributed over a triangle (see @ref interpolateBarycentric ).
+ */
+inline Vector2 squareToUniformTriangle(const Point2 &sample) {
+    const float su = safe_sqrt(sample.x());
+    return { su * (1 - sample.y()), su * sample.y() };
+}
+
 }
@@ -0,0 +1,70 @@
+import numpy as np
+import argparse
+import struct
+
+parser = argparse.ArgumentParser(description='Convert vol binary file to the sparse brick format (.bvol) for lightwave.')
+parser.add_argument('source', metavar='src', type=str,
+                    help='source .vol file path')
+parser.add_argument('destination', metavar='dst', type=str,
+                    help='destination .bvol file path')
+parser.add_argument('--encoding', metavar='e', type=str, required=False, default="float32",
+                    choices=["float32", "float16", "uint8"],
+                    help='how voxel values are stored (uint8 quantizes relative to the maximum value)')
+
+args = parser.parse_args()
+
+# Needs to match src/volumes/bricks.hpp
+MAGIC = b'LWBV'
+VERSION = 1
+BRICK_SIZE = 8
+EMPTY_BRICK = 0xFFFFFFFF
+ENCODINGS = { "float32": 0, "float16": 1, "uint8": 2 }
+
+def convert(filename, outputname, encoding):
+    data = np.fromfile(filename, 'float32')
+    res = (int(data[0]), int(data[1]), int(data[2]))
+    # .vol files store x fastest, then y, then z
+    grid = data[3:].reshape((res[2], res[1], res[0]))
+    print('loading grid...', filename, f'{res[0]} x {res[1]} x {res[2]}')
+
+    # pad the grid to whole bricks with zeros, which is what lookups outside the grid return
+    bricks = tuple((r + BRICK_SIZE - 1) // BRICK_SIZE for r in res)
+    padded = np.zeros((bricks[2] * BRICK_SIZE, bricks[1] * BRICK_SIZE, bricks[0] * BRICK_SIZE), 'float32')
+    padded[:res[2], :res[1], :res[0]] = grid
+
+    # (bz, by, bx, z, y, x): every brick is stored with x fastest, then y, then z
+    blocks = padded.reshape((bricks[2], BRICK_SIZE, bricks[1], BRICK_SIZE, bricks[0], BRICK_SIZE))
+    blocks = blocks.transpose((0, 2, 4, 1, 3, 5)).reshape((-1, BRICK_SIZE ** 3))
+
+    occupied = np.any(blocks != 0, axis=1)
+    index = np.full(len(blocks), EMPTY_BRICK, 'uint32')
+    index[occupied] = np.arange(np.count_nonzero(occupied), dtype='uint32')
+
+    scale = 1.0
+    values = blocks[occupied]
+    if encoding == "float16":
+        values = values.astype('float16')
+    elif encoding == "uint8":
+        max_v = float(values.max()) if values.size > 0 else 0.0
+        scale = max_v / 255 if max_v > 0 else 1.0
+        values = np.clip(np.rint(values / scale), 0, 255).astype('uint8')
+
+    # bounds of the stored values (after quantization), empty bricks count as zero
+    decoded = values.astype('float32') * np.float32(scale)
+    min_v = float(decoded.min()) if decoded.size > 0 else 0.0
+    max_v = float(decoded.max()) if decoded.size > 0 else 0.0
+    if not occupied.all():
+        min_v = min(min_v, 0.0)
+        max_v = max(max_v, 0.0)
+
+    print(f'{np.count_nonzero(occupied)} of {len(blocks)} bricks occupied')
+    print("writing grid...", outputname)
+    with open(outputname, 'wb') as f:
+        f.write(MAGIC)
+        f.write(struct.pack('<I3iII3fI', VERSION, *res, BRICK_SIZE, ENCODINGS[encoding],
+                            scale, min_v, max_v, np.count_nonzero(occupied)))
+        index.astype('<u4').tofile(f)
+        values.astype(values.dtype.newbyteorder('<')).tofile(f)
+    print('done.')
+
+convert(args.source, args.destination, args.encoding)
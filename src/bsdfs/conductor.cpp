@@ -21,10 +21,18 @@ public:
     BsdfSample sample(const Point2 &uv, const Vector &wo, Sampler &rng) const override {
         return {
             reflect(wo, Vector(0.f, 0.f, 1.f)).normalized(),
-            m_reflectance->evaluate(uv)
+            m_reflectance->evaluate(uv),
+            Infinity
         };
     }
 
+    float pdf(const Point2 &uv, const Vector &wo, const Vector &wi) const override {
+        // perfectly specular reflection has no density
+        return 0;
+    }
+
+    bool isSpecular() const override { return true; }
+
     Color albedo(const Point2 &uv) const override {
         return m_reflectance->evaluate(uv);
     }
@@ -32,13 +32,20 @@ public:
         const float fresnel = fresnelDielectric(cos, eta);
         if (rng.next() < fresnel) {
             // Reflection
-            return {reflect(wo, Vector(0, 0, 1)), m_reflectance->evaluate(uv)};
+            return {reflect(wo, Vector(0, 0, 1)), m_reflectance->evaluate(uv), Infinity};
         }
         // Refraction
         const Vector normal = Vector(0, 0, isNegative ? -1 : 1);
-        return { refract(wo, normal, eta), m_transmittance->evaluate(uv) / sqr(eta) };
+        return { refract(wo, normal, eta), m_transmittance->evaluate(uv) / sqr(eta), Infinity };
     }
 
+    float pdf(const Point2 &uv, const Vector &wo, const Vector &wi) const override {
+        // perfectly specular reflection and refraction have no density
+        return 0;
+    }
+
+    bool isSpecular() const override { return true; }
+
     Color albedo(const Point2 &uv) const override {
         return 0.5f * (m_transmittance->evaluate(uv) + m_reflectance->evaluate(uv));
     }
@@ -16,7 +16,11 @@ namespace lightwave {
 
         BsdfSample sample(const Point2 &uv, const Vector &wo, Sampler &rng) const override {
             const Vector sample = squareToCosineHemisphere(rng.next2D());
-            return BsdfSample(sample.normalized(), m_albedo->evaluate(uv));
+            return BsdfSample(sample.normalized(), m_albedo->evaluate(uv), cosineHemispherePdf(sample));
+        }
+
+        float pdf(const Point2 &uv, const Vector &wo, const Vector &wi) const override {
+            return cosineHemispherePdf(wi);
         }
 
         Color albedo(const Point2 &uv) const override {
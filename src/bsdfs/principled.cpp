@@ -18,7 +18,11 @@ struct DiffuseLobe {
 
     BsdfSample sample(const Vector &wo, Sampler &rng) const {
         const Vector sample = squareToCosineHemisphere(rng.next2D());
-        return { sample.normalized(), color };
+        return { sample.normalized(), color, cosineHemispherePdf(sample) };
+    }
+
+    float pdf(const Vector &wo, const Vector &wi) const {
+        return cosineHemispherePdf(wi);
     }
 };
 
@@ -45,7 +49,17 @@ struct MetallicLobe {
         Vector wh = microfacet::sampleGGXVNDF(alpha, wo, rng.next2D());
         Vector reflected = reflect(wo, wh);
 
-        return { reflected, color * microfacet::smithG1(alpha, wh, reflected) };
+        return {
+            reflected,
+            color * microfacet::smithG1(alpha, wh, reflected),
+            microfacet::pdfGGXVNDF(alpha, wh, wo) * microfacet::detReflection(wh, wo)
+        };
+    }
+
+    float pdf(const Vector &wo, const Vector &wi) const {
+        if (!Frame::sameHemisphere(wi, wo)) return 0;
+        const Vector wh = (wi + wo).normalized();
+        return microfacet::pdfGGXVNDF(alpha, wh, wo) * microfacet::detReflection(wh, wo);
     }
 };
 
@@ -89,6 +103,12 @@ class Principled : public Bsdf {
         };
     }
 
+    /// @brief The density of picking either lobe and then sampling @c wi from it.
+    static float pdf(const Combination &combination, const Vector &wo, const Vector &wi) {
+        return combination.diffuseSelectionProb * combination.diffuse.pdf(wo, wi) +
+               (1 - combination.diffuseSelectionProb) * combination.metallic.pdf(wo, wi);
+    }
+
 public:
     Principled(const Properties &properties) {
         m_baseColor = properties.get<Texture>("baseColor");
@@ -107,7 +127,7 @@ public:
         if (m_transparency) {
             float chance = m_transparency->scalar(uv);
             if (rng.next() > chance) {
-                return { -wo, Color(1.0f) };
+                return { -wo, Color(1.0f), Infinity };
             }
         }
         const auto combination = combine(uv, wo);
@@ -116,14 +136,18 @@ public:
         if (rng.next() < diffuseSelectionProb) {
             // Sample diffuse
             auto sample = combination.diffuse.sample(wo, rng);
-            return { sample.wi, sample.weight / diffuseSelectionProb };
+            return { sample.wi, sample.weight / diffuseSelectionProb, pdf(combination, wo, sample.wi) };
         } else {
             // Sample metallic
             auto sample = combination.metallic.sample(wo, rng);
-            return { sample.wi, sample.weight / (1.f - diffuseSelectionProb) };
+            return { sample.wi, sample.weight / (1.f - diffuseSelectionProb), pdf(combination, wo, sample.wi) };
         }
     }
 
+    float pdf(const Point2 &uv, const Vector &wo, const Vector &wi) const override {
+        return pdf(combine(uv, wo), wo, wi);
+    }
+
     Color albedo(const Point2 &uv) const override {
         return m_baseColor->evaluate(uv);
     }
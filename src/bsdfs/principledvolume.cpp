@@ -22,9 +22,16 @@ namespace lightwave {
         BsdfSample sample(const Point2 &uv, const Vector &wo, Sampler &rng) const override {
             const Vector up = Vector(0, 0, 1); // because normal is random
             const float phasePdf = phase(m_phase, (-wo).dot(up));
-            return BsdfSample(up, m_color * phasePdf * m_absorption);
+            return BsdfSample(up, m_color * phasePdf * m_absorption, Infinity);
         }
 
+        float pdf(const Point2 &uv, const Vector &wo, const Vector &wi) const override {
+            // the scattered direction is fixed, hence has no density
+            return 0;
+        }
+
+        bool isSpecular() const override { return true; }
+
         Color albedo(const Point2 &uv) const override {
             return m_color;
         }
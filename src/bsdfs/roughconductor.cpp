@@ -36,7 +36,18 @@ public:
         Vector wh = microfacet::sampleGGXVNDF(alpha, wo, rng.next2D());
         Vector reflected = reflect(wo, wh);
 
-        return { reflected, m_reflectance->evaluate(uv) * microfacet::smithG1(alpha, wh, reflected) };
+        return {
+            reflected,
+            m_reflectance->evaluate(uv) * microfacet::smithG1(alpha, wh, reflected),
+            microfacet::pdfGGXVNDF(alpha, wh, wo) * microfacet::detReflection(wh, wo)
+        };
+    }
+
+    float pdf(const Point2 &uv, const Vector &wo, const Vector &wi) const override {
+        if (!Frame::sameHemisphere(wi, wo)) return 0;
+        const auto alpha = std::max(float(1e-3), sqr(m_roughness->scalar(uv)));
+        const Vector wh = (wi + wo).normalized();
+        return microfacet::pdfGGXVNDF(alpha, wh, wo) * microfacet::detReflection(wh, wo);
     }
 
     Color albedo(const Point2 &uv) const override {
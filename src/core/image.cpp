@@ -5,8 +5,140 @@
 #include <stb_image.h>
 #include <tinyexr.h>
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 namespace lightwave {
 
+namespace {
+
+/**
+ * @brief Writes EXR files with tinyexr, which encodes the scanline chunks of
+ * a file in parallel.
+ * @return Whether the file was written successfully.
+ */
+bool writeEXR(const std::filesystem::path &path, const std::vector<Color> &pixels,
+              const Point2i &resolution, const Image::SaveOptions &options) {
+    const size_t pixelCount = pixels.size();
+
+    // tinyexr expects one plane per channel, in BGR order
+    std::vector<float> planes[3];
+    for (int channel = 0; channel < 3; channel++) {
+        planes[channel].resize(pixelCount);
+        for (size_t i = 0; i < pixelCount; i++)
+            planes[channel][i] = pixels[i][2 - channel];
+    }
+    float *planePointers[3] = { planes[0].data(), planes[1].data(), planes[2].data() };
+
+    EXRImage image;
+    InitEXRImage(&image);
+    image.num_channels = 3;
+    image.images = reinterpret_cast<unsigned char **>(planePointers);
+    image.width = resolution.x();
+    image.height = resolution.y();
+
+    EXRChannelInfo channels[3];
+    int pixelTypes[3], requestedPixelTypes[3];
+    for (int channel = 0; channel < 3; channel++) {
+        channels[channel] = {};
+        channels[channel].name[0] = "BGR"[channel];
+        pixelTypes[channel] = TINYEXR_PIXELTYPE_FLOAT;
+        requestedPixelTypes[channel] = options.half ? TINYEXR_PIXELTYPE_HALF : TINYEXR_PIXELTYPE_FLOAT;
+    }
+
+    EXRHeader header;
+    InitEXRHeader(&header);
+    header.num_channels = 3;
+    header.channels = channels;
+    header.pixel_types = pixelTypes;
+    header.requested_pixel_types = requestedPixelTypes;
+    switch (options.compression) {
+    case Image::Compression::None: header.compression_type = TINYEXR_COMPRESSIONTYPE_NONE; break;
+    case Image::Compression::Zip: header.compression_type = TINYEXR_COMPRESSIONTYPE_ZIP; break;
+    case Image::Compression::Piz: header.compression_type = TINYEXR_COMPRESSIONTYPE_PIZ; break;
+    }
+
+    const char *error = nullptr;
+    if (SaveEXRImageToFile(&image, &header, path.generic_string().c_str(), &error) != TINYEXR_SUCCESS) {
+        logger(EError, "  error saving image %s: %s", path, error ? error : "unknown error");
+        FreeEXRErrorMessage(error);
+        return false;
+    }
+    return true;
+}
+
+/// @brief A background thread that writes images to disk in submission order.
+class ImageWriter {
+    struct Job {
+        std::filesystem::path path;
+        std::vector<Color> pixels;
+        Point2i resolution;
+        Image::SaveOptions options;
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::condition_variable m_idle;
+    std::deque<Job> m_jobs;
+    bool m_busy = false;
+    bool m_stop = false;
+    std::thread m_thread;
+
+    void work() {
+        std::unique_lock lock(m_mutex);
+        while (true) {
+            m_wakeUp.wait(lock, [&]() { return m_stop || !m_jobs.empty(); });
+            if (m_jobs.empty())
+                return;
+
+            Job job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_busy = true;
+            lock.unlock();
+
+            writeEXR(job.path, job.pixels, job.resolution, job.options);
+
+            lock.lock();
+            m_busy = false;
+            if (m_jobs.empty())
+                m_idle.notify_all();
+        }
+    }
+
+public:
+    static ImageWriter &instance() {
+        static ImageWriter writer;
+        return writer;
+    }
+
+    ~ImageWriter() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_wakeUp.notify_one();
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+    void submit(Job job) {
+        std::lock_guard lock(m_mutex);
+        if (!m_thread.joinable())
+            m_thread = std::thread([this]() { work(); });
+        m_jobs.push_back(std::move(job));
+        m_wakeUp.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock lock(m_mutex);
+        m_idle.wait(lock, [&]() { return m_jobs.empty() && !m_busy; });
+    }
+};
+
+} // namespace
+
 void Image::loadImage(const std::filesystem::path &path, bool isLinearSpace) {
     const auto extension = path.extension();
     logger(EInfo, "loading image %s", path);
@@ -51,20 +183,31 @@ void Image::loadImage(const std::filesystem::path &path, bool isLinearSpace) {
 }
 
 void Image::saveAt(const std::filesystem::path &path) const {
-    const char *error;
-
     if (resolution().isZero()) {
         logger(EWarn, "cannot save empty image %s!", path);
         return;
     }
 
     logger(EInfo, "saving image %s", path);
-    if (SaveEXR(reinterpret_cast<const float *>(m_data.data()),
-                m_resolution.x(), m_resolution.y(), 3, true,
-                path.generic_string().c_str(), &error)) {
-        logger(EError, "  error saving image %s: %s", path, error);
+    writeEXR(path, m_data, m_resolution, m_saveOptions);
+}
+
+void Image::save() const {
+    const auto path = m_basePath / (id() + ".exr");
+    if (!m_save) {
+        logger(EDebug, "keeping intermediate image %s in memory", id());
+        return;
+    }
+    if (resolution().isZero()) {
+        logger(EWarn, "cannot save empty image %s!", path);
+        return;
     }
+
+    logger(EInfo, "saving image %s", path);
+    ImageWriter::instance().submit({ path, m_data, m_resolution, m_saveOptions });
 }
+
+void Image::waitForPendingSaves() { ImageWriter::instance().wait(); }
 } // namespace lightwave
 
 REGISTER_CLASS(Image, "image", "default")
@@ -9,13 +9,18 @@ namespace lightwave {
 void Instance::transformFrame(SurfaceEvent &surf) const {
     surf.position = m_transform->apply(surf.position);
 
+    // Account for the change in surface after applying the transformation, which is measured on the underlying
+    // geometry so that the density does not depend on the shading frame
+    Vector geometryTangent, geometryBitangent;
+    buildOrthonormalBasis(surf.geometryNormal, geometryTangent, geometryBitangent);
+    const Vector geometryNormal = m_transform->apply(geometryTangent).cross(m_transform->apply(geometryBitangent));
+    surf.pdf /= geometryNormal.length();
+    surf.geometryNormal = m_flipNormal ? -geometryNormal.normalized() : geometryNormal.normalized();
+
     // Applying T transformation to tangent and bitangent
     surf.frame.tangent = m_transform->apply(surf.frame.tangent);
     surf.frame.bitangent = m_transform->apply(surf.frame.bitangent);
 
-    // Account for the change in surface after applying the transformation
-    surf.pdf /= surf.frame.tangent.cross(surf.frame.bitangent).length();
-
     surf.frame.tangent = surf.frame.tangent.normalized();
     surf.frame.bitangent = surf.frame.bitangent.normalized();
 
@@ -37,36 +42,111 @@ void Instance::transformFrame(SurfaceEvent &surf) const {
     }
 }
 
-bool Instance::intersect(const Ray &worldRay, Intersection &its, Sampler &rng) const {
+void Instance::completeChildHit(const Ray &localRay, Intersection &its) const {
+    if (its.instance) {
+        // the hit belongs to a nested instance, which completes it in our local space
+        its.instance->computeSurfaceInteraction(localRay, its);
+    } else if (its.deferred.shape) {
+        its.deferred.shape->computeSurfaceInteraction(localRay, its);
+    }
+}
+
+void Instance::computeSurfaceInteraction(const Ray &worldRay, Intersection &its) const {
+    if (!its.deferred.shape) {
+        // the shading data has already been completed while intersecting
+        return;
+    }
+
     if (!m_transform) {
-        // fast path, if no transform is needed
-        Ray localRay = worldRay;
-        if (m_shape->intersect(localRay, its, rng)) {
-            if (isTransparent(its.uv, rng)) {
-                return false;
-            }
-            its.instance = this;
-            return true;
-        } else {
-            return false;
-        }
+        its.deferred.shape->computeSurfaceInteraction(worldRay, its);
+        return;
     }
 
-    const Intersection oldIts = its;
     Ray localRay = m_transform->inverse(worldRay);
     // Convert its.t to localspace
     const float scaleFactor = localRay.direction.length();
     its.t *= scaleFactor;
     localRay = localRay.normalized();
 
+    its.deferred.shape->computeSurfaceInteraction(localRay, its);
+
+    // Convert its.t back to worldspace
+    its.t /= scaleFactor;
+    transformFrame(its);
+}
+
+bool Instance::intersect(const Ray &worldRay, Intersection &its, Sampler &rng) const {
+    if (m_alpha || (m_volume && m_transform)) {
+        return intersectWithRejection(worldRay, its, rng);
+    }
+
+    // children report hits of nested instances through its.instance and deferred hits through its.deferred, so we clear
+    // both to tell new hits apart from earlier ones (a miss leaves the intersection untouched otherwise)
+    const float oldT = its.t;
+    const Instance *oldInstance = its.instance;
+    const auto oldDeferred = its.deferred;
+    its.instance = nullptr;
+    its.deferred.shape = nullptr;
+
+    Ray localRay = worldRay;
+    float scaleFactor = 1;
+    if (m_transform) {
+        localRay = m_transform->inverse(worldRay);
+        // Convert its.t to localspace
+        scaleFactor = localRay.direction.length();
+        its.t *= scaleFactor;
+        localRay = localRay.normalized();
+    }
+
+    if (!m_shape->intersect(localRay, its, rng)) {
+        its.t = oldT;
+        its.instance = oldInstance;
+        its.deferred = oldDeferred;
+        return false;
+    }
+
+    // deferred hits of our own shape are only transformed once they are known to be the closest hit (see
+    // computeSurfaceInteraction), all other hits are transformed right away
+    const bool isDeferred = !its.instance && its.deferred.shape;
+    if (!isDeferred) {
+        completeChildHit(localRay, its);
+    }
+
+    its.instance = this;
+    // Convert its.t back to worldspace
+    its.t /= scaleFactor;
+    if (!isDeferred && m_transform) {
+        transformFrame(its);
+    }
+    return true;
+}
+
+bool Instance::intersectWithRejection(const Ray &worldRay, Intersection &its, Sampler &rng) const {
+    const Intersection oldIts = its;
+    its.instance = nullptr;
+    its.deferred.shape = nullptr;
+
+    Ray localRay = worldRay;
+    float scaleFactor = 1;
+    if (m_transform) {
+        localRay = m_transform->inverse(worldRay);
+        // Convert its.t to localspace
+        scaleFactor = localRay.direction.length();
+        its.t *= scaleFactor;
+        localRay = localRay.normalized();
+    }
+
     const bool wasIntersected = m_shape->intersect(localRay, its, rng);
     if (wasIntersected) {
+        // alpha masks need the texture coordinates right away
+        completeChildHit(localRay, its);
+
         if (isTransparent(its.uv, rng)) {
             its = oldIts;
             return false;
         }
 
-        if (m_volume) {
+        if (m_volume && m_transform) {
             // Possibly sample the point in volume instead
             // We do all calculations in local space for convenience/efficiency
             const float rayEpsilonLocal = 0.001f * scaleFactor; // Minimum surface thickness (local space)
@@ -96,6 +176,7 @@ bool Instance::intersect(const Ray &worldRay, Intersection &its, Sampler &rng) c
                 its.instance = this;
                 its.frame.normal = squareToUniformSphere(rng.next2D());
                 buildOrthonormalBasis(its.frame.normal, its.frame.tangent, its.frame.bitangent);
+                its.geometryNormal = its.frame.normal;
                 // Convert nextT back to world space
                 its.t = distance;
                 its.position = worldRay(its.t);
@@ -109,7 +190,9 @@ bool Instance::intersect(const Ray &worldRay, Intersection &its, Sampler &rng) c
         its.instance = this;
         // Convert its.t back to worldspace
         its.t /= scaleFactor;
-        transformFrame(its);
+        if (m_transform) {
+            transformFrame(its);
+        }
         return true;
     } else {
         its = oldIts;
@@ -117,6 +200,68 @@ bool Instance::intersect(const Ray &worldRay, Intersection &its, Sampler &rng) c
     }
 }
 
+bool Instance::occluded(const Ray &worldRay, float tMax, Sampler &rng) const {
+    if (m_alpha || m_volume) {
+        return Shape::occluded(worldRay, tMax, rng);
+    }
+
+    if (!m_transform) {
+        // fast path, if no transform is needed
+        return m_shape->occluded(worldRay, tMax, rng);
+    }
+
+    const Ray localRay = m_transform->inverse(worldRay);
+    // Convert tMax to localspace
+    const float scaleFactor = localRay.direction.length();
+    return m_shape->occluded(localRay.normalized(), tMax * scaleFactor, rng);
+}
+
+float Instance::transmittance(const Ray &worldRay, float tMax, Sampler &rng) const {
+    if (m_alpha || (m_volume && !m_transform)) {
+        return Shape::transmittance(worldRay, tMax, rng);
+    }
+
+    if (!m_transform) {
+        // fast path, if no transform is needed
+        return m_shape->transmittance(worldRay, tMax, rng);
+    }
+
+    Ray localRay = m_transform->inverse(worldRay);
+    // Convert tMax to localspace
+    const float scaleFactor = localRay.direction.length();
+    localRay = localRay.normalized();
+    tMax *= scaleFactor;
+
+    if (!m_volume) {
+        return m_shape->transmittance(localRay, tMax, rng);
+    }
+
+    // Find the segment of the ray inside the volume, like intersectWithRejection does
+    Intersection first(-localRay.direction);
+    if (!m_shape->intersect(localRay, first, rng)) {
+        return 1;
+    }
+
+    const float rayEpsilonLocal = 0.001f * scaleFactor; // Minimum surface thickness (local space)
+    Ray nextLocalRay = localRay;
+    nextLocalRay.origin = localRay(first.t + rayEpsilonLocal);
+    Intersection second(-localRay.direction);
+
+    float tStart = 0;
+    float tEnd = first.t;
+    if (m_shape->intersect(nextLocalRay, second, rng)) {
+        // the ray starts outside and pierces the surface
+        tStart = first.t;
+        tEnd = first.t + rayEpsilonLocal + second.t;
+    }
+
+    tEnd = std::min(tEnd, tMax);
+    if (tStart >= tEnd) {
+        return 1;
+    }
+    return m_volume->transmittance(localRay, tStart, tEnd, scaleFactor, rng);
+}
+
 bool Instance::isTransparent(const Point2 &uv, Sampler &rng) const {
     if (!m_alpha) { return false; }
 
@@ -161,10 +306,45 @@ Point Instance::getCentroid() const {
 
 AreaSample Instance::sampleArea(Sampler &rng) const {
     AreaSample sample = m_shape->sampleArea(rng);
+    if (sample.pdf == 0 || !m_transform) {
+        // sampling failed, or the sample is already in world space
+        return sample;
+    }
+    transformFrame(sample);
+    return sample;
+}
+
+AreaSample Instance::sampleSolidAngle(const Point &origin, Sampler &rng) const {
+    if (!m_preservesAngles || !m_shape->canSampleSolidAngle()) {
+        AreaSample sample = sampleArea(rng);
+        if (sample.pdf != 0) sample.pdf = areaToSolidAngle(sample.pdf, origin, sample);
+        return sample;
+    }
+
+    if (!m_transform) return m_shape->sampleSolidAngle(origin, rng);
+
+    AreaSample sample = m_shape->sampleSolidAngle(m_transform->inverse(origin), rng);
+    if (sample.pdf == 0) return sample;
+
+    // solid angles are invariant under transforms that preserve angles, hence the density remains unchanged
+    const float pdf = sample.pdf;
     transformFrame(sample);
+    sample.pdf = pdf;
     return sample;
 }
 
+float Instance::pdfSolidAngle(const Point &origin, const SurfaceEvent &surface) const {
+    if (!m_preservesAngles || !m_shape->canSampleSolidAngle()) {
+        return areaToSolidAngle(surface.pdf, origin, surface);
+    }
+
+    if (!m_transform) return m_shape->pdfSolidAngle(origin, surface);
+
+    SurfaceEvent local = surface;
+    local.position = m_transform->inverse(surface.position);
+    return m_shape->pdfSolidAngle(m_transform->inverse(origin), local);
+}
+
 }
 
 REGISTER_CLASS(Instance, "instance", "default")
@@ -4,12 +4,54 @@
 
 #include <algorithm>
 #include <chrono>
+#include <numeric>
 
 #include <lightwave/streaming.hpp>
 #include <lightwave/iterators.hpp>
 
 namespace lightwave {
 
+namespace {
+
+/// @brief Splits an image into the tiles it is rendered in, from the center outwards.
+std::vector<Bounds2i> imageTiles(const Vector2i &resolution) {
+    std::vector<Bounds2i> tiles;
+    for (auto block : BlockSpiral(resolution, Vector2i(64)))
+        tiles.push_back(block);
+    return tiles;
+}
+
+/**
+ * @brief Invokes @c f for the index of every tile listed in @c order (preferably in that order). Tiles are assigned
+ * to NUMA nodes in horizontal bands, so that each node renders a contiguous range of rows, and buffers of a tile
+ * first touched by @c f stay local to the node that renders it in every pass.
+ */
+template <typename Function>
+void forEachTile(const std::vector<Bounds2i> &tiles, const std::vector<int> &order, const Vector2i &resolution,
+                 Function f) {
+    const int numNodes = ThreadPool::instance().numberOfNodes();
+    const auto node = [&](int rank) {
+        const Bounds2i &tile = tiles[order[rank]];
+        return std::min(numNodes - 1, (tile.min().y() + tile.max().y()) * numNodes / (2 * resolution.y()));
+    };
+    parallel_for_nodes(0, int(order.size()), node, [&](int rank) { f(order[rank]); });
+}
+
+/// @brief Invokes @c f for the index of every tile, see above.
+template <typename Function>
+void forEachTile(const std::vector<Bounds2i> &tiles, const Vector2i &resolution, Function f) {
+    std::vector<int> order(tiles.size());
+    std::iota(order.begin(), order.end(), 0);
+    forEachTile(tiles, order, resolution, f);
+}
+
+/// @brief Returns the index of a pixel within the buffer of a tile.
+int pixelInTile(const Bounds2i &tile, const Point2i &pixel) {
+    return (pixel.y() - tile.min().y()) * tile.diagonal().x() + pixel.x() - tile.min().x();
+}
+
+}
+
 void SamplingIntegrator::execute() {
     if (!m_image) {
         lightwave_throw("<integrator /> needs an <image /> child to render into!");
@@ -18,28 +60,274 @@ void SamplingIntegrator::execute() {
     const Vector2i resolution = m_scene->camera()->resolution();
     m_image->initialize(resolution);
 
-    const float norm = 1.0f / m_sampler->samplesPerPixel();
+    for (auto &image : { m_sampleCountImage, m_albedoImage, m_normalsImage, m_distanceImage }) {
+        if (image)
+            image->initialize(resolution);
+    }
+
+    if (m_adaptive)
+        renderAdaptive();
+    else if (m_progressive)
+        renderProgressive();
+    else
+        renderBlocks();
+
+    m_image->save();
+    for (auto &image : { m_sampleCountImage, m_albedoImage, m_normalsImage, m_distanceImage }) {
+        if (image)
+            image->save();
+    }
+}
+
+Color SamplingIntegrator::samplePixel(const Point2i &pixel, int sample, Sampler &rng, PixelSums &sums) {
+    rng.seed(pixel, sample);
+    auto cameraSample = m_scene->camera()->sample(pixel, rng);
+
+    Color value;
+    if (hasFirstHitImages()) {
+        FirstHit firstHit;
+        value = cameraSample.weight * LiWithFirstHit(cameraSample.ray, rng, firstHit);
+        sums.albedo += firstHit.albedo;
+        sums.normal += firstHit.normal;
+        sums.depth += firstHit.depth;
+    } else {
+        value = cameraSample.weight * Li(cameraSample.ray, rng);
+    }
+
+    sums.color += value;
+    return value;
+}
+
+void SamplingIntegrator::writePixel(const Point2i &pixel, const PixelSums &sums, int count) {
+    const float norm = 1.0f / count;
+    m_image->get(pixel) = norm * sums.color;
+    if (m_sampleCountImage)
+        m_sampleCountImage->get(pixel) = Color(float(count));
+    if (m_albedoImage)
+        m_albedoImage->get(pixel) = norm * sums.albedo;
+    if (m_normalsImage) {
+        const Vector normal = norm * sums.normal;
+        m_normalsImage->get(pixel) = m_remapNormals ? Color((normal + Vector(1.f)) * 0.5f) : Color(normal);
+    }
+    if (m_distanceImage)
+        m_distanceImage->get(pixel) = Color(norm * sums.depth);
+}
+
+void SamplingIntegrator::renderBlocks() {
+    const Vector2i resolution = m_scene->camera()->resolution();
+    const std::vector<Bounds2i> tiles = imageTiles(resolution);
     
     Streaming stream { *m_image };
     ProgressReporter progress { resolution.product() };
-    for_each_parallel(BlockSpiral(resolution, Vector2i(64)), [&](auto block) {
+    forEachTile(tiles, resolution, [&](int tile) {
+        const Bounds2i &block = tiles[tile];
         auto sampler = m_sampler->clone();
         for (auto pixel : block) {
-            Color sum;
+            PixelSums sums;
             for (int sample = 0; sample < m_sampler->samplesPerPixel(); sample++) {
-                sampler->seed(pixel, sample);
-                auto cameraSample = m_scene->camera()->sample(pixel, *sampler);
-                sum += cameraSample.weight * Li(cameraSample.ray, *sampler);
+                samplePixel(pixel, sample, *sampler, sums);
             }
-            m_image->get(pixel) = norm * sum;
+            writePixel(pixel, sums, m_sampler->samplesPerPixel());
         }
 
         progress += block.diagonal().product();
         stream.updateBlock(block);
     });
     progress.finish();
+}
 
-    m_image->save();
+void SamplingIntegrator::renderProgressive() {
+    const Vector2i resolution = m_scene->camera()->resolution();
+    const int targetSamples = m_sampler->samplesPerPixel();
+    const int numPasses = (targetSamples + m_passSamples - 1) / m_passSamples;
+
+    const std::vector<Bounds2i> tiles = imageTiles(resolution);
+
+    // the image always holds the mean of the passes completed so far, while
+    // the running sums are kept separately (so that a finished render matches
+    // the block-wise result exactly), per tile and allocated by the thread
+    // that first renders it
+    std::vector<std::vector<PixelSums>> accumulation(tiles.size());
+
+    Streaming stream { *m_image };
+    stream.startRegularUpdates();
+
+    ProgressReporter progress { numPasses * int(tiles.size()) };
+    Timer timer;
+
+    int samplesDone = 0;
+    float lastPassTime = 0;
+    while (samplesDone < targetSamples) {
+        // stop early if the next pass would likely exceed the time budget
+        const float elapsed = timer.getElapsedTime();
+        if (samplesDone > 0 && elapsed + lastPassTime > m_timeBudget) {
+            break;
+        }
+
+        const int passEnd = std::min(samplesDone + m_passSamples, targetSamples);
+        forEachTile(tiles, resolution, [&](int tile) {
+            const Bounds2i &block = tiles[tile];
+            if (accumulation[tile].empty())
+                accumulation[tile].resize(block.diagonal().product());
+
+            auto sampler = m_sampler->clone();
+            for (auto pixel : block) {
+                PixelSums &sums = accumulation[tile][pixelInTile(block, pixel)];
+                for (int sample = samplesDone; sample < passEnd; sample++) {
+                    samplePixel(pixel, sample, *sampler, sums);
+                }
+                writePixel(pixel, sums, passEnd);
+            }
+            progress += 1;
+        });
+
+        samplesDone = passEnd;
+        lastPassTime = timer.getElapsedTime() - elapsed;
+    }
+
+    stream.stopRegularUpdates();
+    stream.update();
+    progress.finish();
+
+    if (samplesDone < targetSamples) {
+        logger(EInfo, "time budget of %.1fs reached after %d of %d samples per pixel",
+               m_timeBudget, samplesDone, targetSamples);
+    }
+}
+
+void SamplingIntegrator::renderAdaptive() {
+    const Vector2i resolution = m_scene->camera()->resolution();
+    const int minSamples = std::min(m_adaptiveMinSamples, m_sampler->samplesPerPixel());
+    // every pixel could have received samplesPerPixel samples; converged
+    // pixels hand their share to the ones that are still noisy
+    const int64_t budget = int64_t(resolution.product()) * m_sampler->samplesPerPixel();
+
+    /// running statistics of a pixel (Welford's algorithm on luminance)
+    struct PixelStatistics {
+        PixelSums sums;
+        float mean = 0;
+        float m2 = 0;
+        int count = 0;
+        bool converged = false;
+    };
+    const std::vector<Bounds2i> tiles = imageTiles(resolution);
+    // per tile, allocated by the thread that first renders it
+    std::vector<std::vector<PixelStatistics>> statistics(tiles.size());
+    // the largest relative error of any unconverged pixel in each tile
+    std::vector<float> tileErrors(tiles.size(), Infinity);
+
+    Streaming stream { *m_image };
+    stream.startRegularUpdates();
+
+    const int64_t progressUnit = std::max<int64_t>(1, budget >> 20);
+    ProgressReporter progress { int(budget / progressUnit) };
+    Timer timer;
+
+    std::atomic<int64_t> samplesUsed = 0;
+    float lastPassTime = 0;
+    int numPasses = 0;
+    while (samplesUsed < budget) {
+        std::vector<int> order;
+        for (int tile = 0; tile < int(tiles.size()); tile++) {
+            if (tileErrors[tile] > 0)
+                order.push_back(tile);
+        }
+        if (order.empty()) {
+            break;
+        }
+
+        const float elapsed = timer.getElapsedTime();
+        if (numPasses > 0 && elapsed + lastPassTime > m_timeBudget) {
+            break;
+        }
+
+        // visit the noisiest tiles first, so that they receive the remaining
+        // budget once it runs out
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return tileErrors[a] > tileErrors[b];
+        });
+
+        // tiles noisier than average receive proportionally more samples
+        double errorSum = 0;
+        int errorCount = 0;
+        for (int tile : order) {
+            if (std::isfinite(tileErrors[tile])) {
+                errorSum += tileErrors[tile];
+                errorCount++;
+            }
+        }
+        const float meanError = errorCount ? float(errorSum / errorCount) : 0;
+        const auto passSamples = [&](int tile) {
+            if (!std::isfinite(tileErrors[tile]) || meanError <= 0)
+                return m_passSamples;
+            return m_passSamples *
+                   std::clamp(int(std::round(tileErrors[tile] / meanError)), 1, 4);
+        };
+
+        forEachTile(tiles, order, resolution, [&](int tile) {
+            if (samplesUsed >= budget) {
+                return;
+            }
+
+            const Bounds2i &block = tiles[tile];
+            if (statistics[tile].empty())
+                statistics[tile].resize(block.diagonal().product());
+
+            auto sampler = m_sampler->clone();
+            const int tileSamples = passSamples(tile);
+            int64_t samplesTaken = 0;
+            float tileError = 0;
+            for (auto pixel : block) {
+                auto &pixelStatistics = statistics[tile][pixelInTile(block, pixel)];
+                if (pixelStatistics.converged)
+                    continue;
+
+                for (int sample = 0; sample < tileSamples; sample++) {
+                    const Color value = samplePixel(pixel, pixelStatistics.count, *sampler,
+                                                    pixelStatistics.sums);
+                    const float luminance = value.luminance();
+                    pixelStatistics.count++;
+
+                    const float delta = luminance - pixelStatistics.mean;
+                    pixelStatistics.mean += delta / pixelStatistics.count;
+                    pixelStatistics.m2 += delta * (luminance - pixelStatistics.mean);
+                }
+                samplesTaken += tileSamples;
+
+                const int count = pixelStatistics.count;
+                writePixel(pixel, pixelStatistics.sums, count);
+
+                if (count < minSamples) {
+                    tileError = Infinity;
+                    continue;
+                }
+
+                // relative standard error of the mean (dark pixels are
+                // measured against a small absolute floor instead)
+                const float variance = pixelStatistics.m2 / (count - 1);
+                const float error = std::sqrt(variance / count) /
+                                    std::max(pixelStatistics.mean, 1e-3f);
+                if (error < m_adaptiveThreshold)
+                    pixelStatistics.converged = true;
+                else
+                    tileError = std::max(tileError, error);
+            }
+
+            tileErrors[tile] = tileError;
+            samplesUsed += samplesTaken;
+            progress += int(samplesTaken / progressUnit);
+        });
+
+        numPasses++;
+        lastPassTime = timer.getElapsedTime() - elapsed;
+    }
+
+    stream.stopRegularUpdates();
+    stream.update();
+    progress.finish();
+
+    logger(EInfo, "adaptive sampling used %.1f%% of the sample budget in %d passes",
+           100.0 * double(samplesUsed) / double(budget), numPasses);
 }
 
 }
@@ -0,0 +1,120 @@
+#include "lightbvh.hpp"
+
+#include <algorithm>
+
+namespace lightwave {
+
+/// @brief The largest float below one, used to keep remapped random numbers in [0,1).
+static constexpr float OneMinusEpsilon = 0x1.fffffep-1f;
+
+LightBVH::LightBVH(std::vector<Entry> entries) {
+    if (entries.empty())
+        return;
+
+    std::vector<int> order(entries.size());
+    for (int i = 0; i < int(order.size()); i++)
+        order[i] = i;
+
+    m_trails.resize(entries.size());
+    m_nodes.reserve(2 * entries.size() - 1);
+    build(entries, order, 0, int(entries.size()), 0, 0);
+}
+
+int LightBVH::build(std::vector<Entry> &entries, std::vector<int> &order, int first, int last, int depth,
+                    uint64_t trail) {
+    const int nodeIndex = int(m_nodes.size());
+    m_nodes.emplace_back();
+
+    Bounds bounds, centroids;
+    float power = 0;
+    for (int i = first; i < last; i++) {
+        const Entry &entry = entries[order[i]];
+        bounds.extend(entry.bounds);
+        centroids.extend(entry.bounds.center());
+        power += entry.power;
+    }
+
+    if (last - first == 1) {
+        m_nodes[nodeIndex]     = { bounds, power, order[first], true };
+        m_trails[order[first]] = trail;
+        return nodeIndex;
+    }
+
+    // median split along the axis in which the lights are spread out the most
+    int axis             = 0;
+    const Vector extent  = centroids.diagonal();
+    for (int dim = 1; dim < extent.Dimension; dim++)
+        if (extent[dim] > extent[axis])
+            axis = dim;
+
+    const int middle = (first + last) / 2;
+    std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + last,
+                     [&](int a, int b) {
+                         return entries[a].bounds.center()[axis] < entries[b].bounds.center()[axis];
+                     });
+
+    // median splits keep the hierarchy balanced, so even millions of lights fit into the 64 bits of the trail
+    if (depth >= 64)
+        lightwave_throw("light hierarchy is too deep");
+    build(entries, order, first, middle, depth + 1, trail);
+    const int second = build(entries, order, middle, last, depth + 1, trail | (uint64_t(1) << depth));
+
+    m_nodes[nodeIndex] = { bounds, power, second, false };
+    return nodeIndex;
+}
+
+float LightBVH::importance(const Node &node, const Point &origin) const {
+    const float distanceSquared = (node.bounds.center() - origin).lengthSquared();
+    const float extentSquared   = node.bounds.diagonal().lengthSquared() / 4;
+    return node.power / std::max({ distanceSquared, extentSquared, Epsilon });
+}
+
+float LightBVH::firstChildProbability(int node, const Point &origin) const {
+    const float first  = importance(m_nodes[node + 1], origin);
+    const float second = importance(m_nodes[m_nodes[node].index], origin);
+    if (first + second == 0)
+        return 0.5f;
+    return first / (first + second);
+}
+
+int LightBVH::sample(const Point &origin, float u, float &probability) const {
+    probability = 1;
+    if (m_nodes.empty())
+        return -1;
+
+    int node = 0;
+    while (!m_nodes[node].leaf) {
+        const float p = firstChildProbability(node, origin);
+        if (u < p) {
+            u = std::min(u / p, OneMinusEpsilon);
+            probability *= p;
+            node = node + 1;
+        } else {
+            u = std::min((u - p) / (1 - p), OneMinusEpsilon);
+            probability *= 1 - p;
+            node = m_nodes[node].index;
+        }
+    }
+
+    return probability > 0 ? m_nodes[node].index : -1;
+}
+
+float LightBVH::probability(int index, const Point &origin) const {
+    const uint64_t trail = m_trails[index];
+
+    float probability = 1;
+    int node          = 0;
+    for (int depth = 0; !m_nodes[node].leaf; depth++) {
+        const float p = firstChildProbability(node, origin);
+        if (trail & (uint64_t(1) << depth)) {
+            probability *= 1 - p;
+            node = m_nodes[node].index;
+        } else {
+            probability *= p;
+            node = node + 1;
+        }
+    }
+    return probability;
+}
+
+} // namespace lightwave
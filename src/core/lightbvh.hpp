@@ -0,0 +1,69 @@
+#pragma once
+
+#include <lightwave/core.hpp>
+#include <lightwave/math.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace lightwave {
+
+/**
+ * @brief A bounding volume hierarchy over light sources that picks lights by their estimated contribution to a
+ * shading point, so that far away or dim lights are sampled less often than close and bright ones.
+ * Traversal descends from the root and picks a child proportionally to its importance, given by its power over its
+ * squared distance to the shading point (clamped by the extent of the node, so that lights close to the shading point
+ * cannot dominate arbitrarily).
+ * @note Every light keeps a non-zero probability, hence sampling remains unbiased.
+ */
+class LightBVH {
+public:
+    /// @brief A light source that is placed within the hierarchy.
+    struct Entry {
+        const Light *light;
+        Bounds bounds;
+        float power;
+    };
+
+    LightBVH(std::vector<Entry> entries);
+
+    /// @brief Returns the summed power of all lights in the hierarchy.
+    float power() const { return m_nodes.empty() ? 0 : m_nodes.front().power; }
+
+    /**
+     * @brief Picks a light for the given shading point.
+     * @param origin The shading point.
+     * @param u A uniform random number in [0,1) that steers the traversal.
+     * @param probability Receives the probability of having picked the light.
+     * @return The index of the light within the list of entries the hierarchy was built with, or -1 if no light has
+     * a non-zero probability.
+     */
+    int sample(const Point &origin, float u, float &probability) const;
+    /// @brief Returns the probability of @ref sample picking the light with the given entry index.
+    float probability(int index, const Point &origin) const;
+
+private:
+    struct Node {
+        Bounds bounds;
+        float power;
+        /// @brief For leaves, the index of the entry, for interior nodes the index of the second child (the first
+        /// child directly follows its parent).
+        int index;
+        bool leaf;
+    };
+
+    std::vector<Node> m_nodes;
+    /**
+     * @brief For each entry, the decisions that lead from the root to its leaf: bit i is set if the second child
+     * has to be taken at depth i.
+     */
+    std::vector<uint64_t> m_trails;
+
+    int build(std::vector<Entry> &entries, std::vector<int> &order, int first, int last, int depth,
+              uint64_t trail);
+    float importance(const Node &node, const Point &origin) const;
+    /// @brief Returns the probability of descending into the first child of an interior node.
+    float firstChildProbability(int node, const Point &origin) const;
+};
+
+} // namespace lightwave
@@ -1,10 +1,15 @@
 #include <lightwave/core.hpp>
 #include <lightwave/registry.hpp>
 #include <lightwave/logger.hpp>
+#include <lightwave/parallel.hpp>
+#include <lightwave/camera.hpp>
+#include <lightwave/integrator.hpp>
 
 #include "parser.hpp"
+#include "scheduler.hpp"
 
 #include <fstream>
+#include <cstring>
 
 #ifdef LW_OS_WINDOWS
 #include <cstdlib>
@@ -21,6 +26,55 @@ void print_exception(const std::exception &e, int level = 0) {
     } catch(...) {}
 }
 
+void print_usage() {
+    logger(EInfo, "usage: zeus [options] <scene.xml>\n"
+                  "  --threads <count>  number of threads to render with (default: all CPUs)\n"
+                  "  --pin              pin threads to CPUs, filling one NUMA node after another\n"
+                  "  --scaling          render every executable at 1..N threads and report throughput");
+}
+
+/// @brief Runs an executable with increasing thread counts and reports how
+/// well it scales.
+void report_scaling(Executable &executable, ThreadPool::Settings settings) {
+    const int maxThreads = settings.threads > 0 ? settings.threads : numberOfThreads();
+
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    // throughput is reported in camera samples where possible
+    double work = 1;
+    const char *unit = "runs";
+    if (auto integrator = dynamic_cast<SamplingIntegrator *>(&executable)) {
+        work = double(integrator->scene()->camera()->resolution().product()) *
+               integrator->sampler()->samplesPerPixel() * 1e-6;
+        unit = "Msamples";
+    }
+
+    std::vector<double> times;
+    for (int threads : threadCounts) {
+        settings.threads = threads;
+        ThreadPool::instance().configure(settings, true);
+
+        Timer timer;
+        executable.execute();
+        times.push_back(timer.getElapsedTime());
+    }
+
+    std::string report = tfm::format("scaling report for %s\n", executable.id());
+    report += tfm::format("  %8s %10s %14s %8s %10s\n", "threads", "time [s]",
+                          tfm::format("%s/s", unit), "speedup", "efficiency");
+    for (size_t i = 0; i < threadCounts.size(); i++) {
+        const double speedup = times[0] / times[i];
+        report += tfm::format("  %8d %10.3f %14.3f %7.2fx %9.1f%%\n",
+                              threadCounts[i], times[i], work / times[i],
+                              speedup, 100 * speedup / threadCounts[i]);
+    }
+    report.pop_back();
+    logger(EInfo, "%s", report);
+}
+
 int main(int argc, const char *argv[]) {
 #ifdef LW_DEBUG
     logger(EWarn, "lightwave was compiled in Debug mode, expect rendering to be much slower");
@@ -35,20 +89,55 @@ int main(int argc, const char *argv[]) {
 #endif
 
     try {
-        if (argc <= 1) {
+        ThreadPool::Settings threadSettings;
+        bool hasThreadSettings = false;
+        bool scaling = false;
+        std::filesystem::path scenePath;
+        for (int i = 1; i < argc; i++) {
+            if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+                threadSettings.threads = std::max(0, std::atoi(argv[++i]));
+                hasThreadSettings = true;
+            } else if (!strcmp(argv[i], "--pin")) {
+                threadSettings.pin = true;
+                hasThreadSettings = true;
+            } else if (!strcmp(argv[i], "--scaling")) {
+                scaling = true;
+            } else if (argv[i][0] == '-' || !scenePath.empty()) {
+                print_usage();
+                return -1;
+            } else {
+                scenePath = argv[i];
+            }
+        }
+
+        if (scenePath.empty()) {
             logger(EError, "please specify path to scene");
+            print_usage();
             return -1;
         }
-        
-        std::filesystem::path scenePath = argv[1];
+
+        // command line options take precedence over thread settings in the scene
+        if (hasThreadSettings)
+            ThreadPool::instance().configure(threadSettings, true);
 
         SceneParser parser { scenePath };
+        std::vector<ref<Executable>> executables;
         for (auto &object : parser.objects()) {
-            if (auto executable = dynamic_cast<Executable *>(object.get())) {
-                executable->execute();
+            if (auto executable = std::dynamic_pointer_cast<Executable>(object)) {
+                executables.push_back(executable);
             }
         }
+
+        if (scaling) {
+            for (auto &executable : executables)
+                report_scaling(*executable, threadSettings);
+        } else {
+            Scheduler scheduler { executables };
+            scheduler.execute();
+        }
+        Image::waitForPendingSaves();
     } catch(const std::exception &e) {
+        Image::waitForPendingSaves();
         print_exception(e);
         return 1;
     }
@@ -150,7 +150,8 @@ Vector2 directionToSphereUV(const Vector& dir)
 
 Color Intersection::evaluateEmission() const {
     if (!instance->emission()) return Color::black();
-    return instance->emission()->evaluate(uv, frame.toLocal(wo)).value;
+    // the side that emits is decided by the geometry, as for light samples (see AreaLight::sampleDirect)
+    return instance->emission()->evaluate(uv, Frame(geometryNormal).toLocal(wo)).value;
 }
 
 BsdfSample Intersection::sampleBsdf(Sampler &rng) const {
@@ -175,4 +176,10 @@ BsdfEval Intersection::evaluateBsdf(const Vector &wi) const {
     return instance->bsdf()->evaluate(uv, frame.toLocal(wo), frame.toLocal(wi));
 }
 
+float Intersection::pdfBsdf(const Vector &wi) const {
+    if (!instance->bsdf())
+        return 0;
+    return instance->bsdf()->pdf(uv, frame.toLocal(wo), frame.toLocal(wi));
+}
+
 }
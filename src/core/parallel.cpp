@@ -0,0 +1,339 @@
+#include <lightwave/parallel.hpp>
+
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#ifdef LW_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace lightwave {
+
+/// @brief The index of the queue owned by the current thread. Threads outside
+/// of the pool use the shared queue at the end of the list.
+static thread_local int t_queueIndex = -1;
+
+namespace {
+
+/// @brief A CPU the process may run on, together with its NUMA node.
+struct Processor {
+    int cpu;
+    int node;
+};
+
+/// @brief Parses CPU lists of the form "0-3,8,10-11" as used by sysfs.
+std::vector<int> parseCpuList(const std::string &list) {
+    std::vector<int> cpus;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        int first, last;
+        const auto dash = range.find('-');
+        try {
+            first = std::stoi(range.substr(0, dash));
+            last  = dash == std::string::npos ? first
+                                              : std::stoi(range.substr(dash + 1));
+        } catch (const std::exception &) {
+            continue;
+        }
+        for (int cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+/**
+ * @brief Lists the CPUs the process is allowed to run on (respecting e.g.
+ * taskset and cgroup limits), sorted by NUMA node.
+ */
+std::vector<Processor> queryProcessors() {
+    std::vector<Processor> processors;
+#ifdef LW_OS_LINUX
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        std::vector<int> nodeOf(CPU_SETSIZE, 0);
+        std::error_code error;
+        for (const auto &entry : std::filesystem::directory_iterator(
+                 "/sys/devices/system/node", error)) {
+            const auto name = entry.path().filename().string();
+            if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+                !std::isdigit(name[4]))
+                continue;
+
+            std::ifstream file(entry.path() / "cpulist");
+            std::string list;
+            std::getline(file, list);
+            for (int cpu : parseCpuList(list))
+                if (cpu < CPU_SETSIZE)
+                    nodeOf[cpu] = std::stoi(name.substr(4));
+        }
+
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, &allowed))
+                processors.push_back({ cpu, nodeOf[cpu] });
+        std::stable_sort(processors.begin(), processors.end(),
+                         [](const Processor &a, const Processor &b) {
+                             return a.node < b.node;
+                         });
+    }
+#endif
+
+    if (processors.empty()) {
+        const int count = std::max(1, int(std::thread::hardware_concurrency()));
+        for (int cpu = 0; cpu < count; cpu++)
+            processors.push_back({ cpu, 0 });
+    }
+    return processors;
+}
+
+/**
+ * @brief The CPUs the process was allowed to run on when the pool was first
+ * started. They are only queried once, since pinning the calling thread
+ * narrows down what later queries would report.
+ */
+const std::vector<Processor> &availableProcessors() {
+    static const std::vector<Processor> processors = queryProcessors();
+    return processors;
+}
+
+/// @brief Restricts a thread to run on the given CPUs.
+void setAffinity(std::thread::native_handle_type thread,
+                 const std::vector<int> &cpus) {
+#ifdef LW_OS_LINUX
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+        CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(thread, sizeof(set), &set) != 0)
+        logger(EWarn, "could not set the affinity of a thread to %d CPU(s)",
+               cpus.size());
+#else
+    (void) thread;
+    (void) cpus;
+    logger(EWarn, "pinning threads is not supported on this platform");
+#endif
+}
+
+/// @brief Restricts the calling thread to the given CPUs.
+void setCallerAffinity(const std::vector<int> &cpus) {
+#ifdef LW_OS_LINUX
+    setAffinity(pthread_self(), cpus);
+#else
+    (void) cpus;
+#endif
+}
+
+} // namespace
+
+ThreadPool &ThreadPool::instance() {
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::ThreadPool() {
+#ifdef SINGLE_THREADED
+    m_settings.threads = 1;
+#endif
+    start();
+}
+
+ThreadPool::~ThreadPool() { stop(); }
+
+void ThreadPool::configure(const Settings &settings, bool fix) {
+    if (m_fixed && !fix) {
+        logger(EDebug, "ignoring thread settings, they are fixed by the "
+                       "command line");
+        return;
+    }
+    m_fixed |= fix;
+    if (settings == m_settings)
+        return;
+
+    if (m_activeGroups > 0) {
+        // workers are joined while restarting, which would never return
+        // while they wait for tasks of a running group
+        logger(EError, "cannot reconfigure the thread pool while %d task "
+                       "group(s) are running",
+               m_activeGroups.load());
+        abort();
+    }
+
+    stop();
+    m_settings = settings;
+    start();
+}
+
+void ThreadPool::start() {
+    const auto &processors = availableProcessors();
+    const int numThreads  = m_settings.threads > 0
+                                ? m_settings.threads
+                                : int(processors.size());
+    const int numWorkers  = numThreads - 1;
+
+    // the calling thread takes the first processor, workers follow in order
+    // (nodes are numbered consecutively in the order they are first used)
+    std::vector<int> nodes(numThreads);
+    std::map<int, int> nodeIndices;
+    for (int thread = 0; thread < numThreads; thread++) {
+        const int node = processors[thread % processors.size()].node;
+        nodes[thread]  = nodeIndices.emplace(node, int(nodeIndices.size()))
+                            .first->second;
+    }
+    m_numNodes = int(nodeIndices.size());
+
+    m_queues.clear();
+    for (int i = 0; i <= numWorkers; i++)
+        m_queues.push_back(std::make_unique<Queue>());
+
+    // workers steal from their own NUMA node first, and only then cross
+    // sockets (visiting the shared queue in between)
+    m_victims.assign(numWorkers + 1, {});
+    for (int index = 0; index <= numWorkers; index++) {
+        auto &victims   = m_victims[index];
+        const int node  = nodes[(index + 1) % numThreads];
+        const int count = numWorkers + 1;
+        victims.push_back(index);
+        for (int offset = 1; offset < count; offset++) {
+            const int other = (index + offset) % count;
+            if (other < numWorkers && nodes[other + 1] == node)
+                victims.push_back(other);
+        }
+        if (index < numWorkers)
+            victims.push_back(numWorkers);
+        for (int offset = 1; offset < count; offset++) {
+            const int other = (index + offset) % count;
+            if (other < numWorkers && nodes[other + 1] != node)
+                victims.push_back(other);
+        }
+    }
+
+    m_nodeQueues.assign(m_numNodes, {});
+    for (int index = 0; index < numWorkers; index++)
+        m_nodeQueues[nodes[index + 1]].push_back(index);
+    m_nodeSubmissions = std::make_unique<std::atomic<unsigned>[]>(m_numNodes);
+
+    m_stop = false;
+    m_workers.reserve(numWorkers);
+    for (int i = 0; i < numWorkers; i++) {
+        m_workers.emplace_back([this, i]() { work(i); });
+        if (m_settings.pin)
+            setAffinity(m_workers.back().native_handle(),
+                        { processors[(i + 1) % processors.size()].cpu });
+    }
+
+    // the calling thread executes tasks while it waits for them, so it is
+    // pinned to the first processor as well (or released again when pinning
+    // has been turned off)
+    if (m_settings.pin) {
+        setCallerAffinity({ processors[0].cpu });
+        m_pinnedCaller = true;
+    } else if (m_pinnedCaller) {
+        std::vector<int> cpus;
+        for (const auto &processor : processors)
+            cpus.push_back(processor.cpu);
+        setCallerAffinity(cpus);
+        m_pinnedCaller = false;
+    }
+
+    if (numThreads > int(processors.size()))
+        logger(EWarn, "running %d threads on %d available CPUs", numThreads,
+               processors.size());
+    logger(EDebug, "thread pool uses %d threads on %d NUMA node(s)%s",
+           numThreads, m_numNodes, m_settings.pin ? ", pinned" : "");
+}
+
+void ThreadPool::stop() {
+    {
+        std::lock_guard lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+    for (auto &worker : m_workers)
+        worker.join();
+    m_workers.clear();
+}
+
+void ThreadPool::submit(Task task, int node) {
+    int index = t_queueIndex >= 0 ? t_queueIndex : int(m_workers.size());
+    if (node >= 0 && node < m_numNodes && !m_nodeQueues[node].empty()) {
+        const auto &queues = m_nodeQueues[node];
+        index = queues[m_nodeSubmissions[node]++ % queues.size()];
+    }
+    push(index, std::move(task));
+}
+
+void ThreadPool::push(int index, Task task) {
+    {
+        std::lock_guard lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back(std::move(task));
+    }
+
+    {
+        // taking the lock prevents workers from missing the notification
+        // between checking for work and going to sleep
+        std::lock_guard lock(m_sleepMutex);
+        m_pending++;
+    }
+    m_wakeUp.notify_one();
+}
+
+bool ThreadPool::takeTask(int index, Task &task) {
+    for (int victim : m_victims[index]) {
+        auto &queue = *m_queues[victim];
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+
+        if (victim == index) {
+            // own queue: most recently submitted task first
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            // steal the oldest task, which tends to be the largest one
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        m_pending--;
+        return true;
+    }
+    return false;
+}
+
+bool ThreadPool::runPendingTask() {
+    if (m_pending == 0)
+        return false;
+
+    Task task;
+    const int index = t_queueIndex >= 0 ? t_queueIndex : int(m_workers.size());
+    if (!takeTask(index, task))
+        return false;
+
+    task();
+    return true;
+}
+
+void ThreadPool::work(int index) {
+    t_queueIndex = index;
+
+    Task task;
+    while (true) {
+        if (takeTask(index, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock lock(m_sleepMutex);
+        m_wakeUp.wait(lock, [&]() { return m_stop || m_pending > 0; });
+        if (m_stop)
+            return;
+    }
+}
+
+} // namespace lightwave
@@ -2,8 +2,12 @@
 #include <lightwave/registry.hpp>
 #include <lightwave/integrator.hpp>
 #include <lightwave/shape.hpp>
+#include <lightwave/instance.hpp>
 #include <lightwave/camera.hpp>
 #include <lightwave/light.hpp>
+#include <lightwave/sampler.hpp>
+
+#include "lightbvh.hpp"
 
 namespace lightwave {
 
@@ -20,6 +24,82 @@ Scene::Scene(const Properties &properties) {
     }
 
     m_shape->markAsVisible();
+
+    m_lightSelection = properties.getEnum<LightSelection>("lightSelection", LightSelection::Uniform, {
+        { "uniform", LightSelection::Uniform },
+        { "power", LightSelection::Power },
+        { "bvh", LightSelection::Hierarchy },
+    });
+    buildLightSelection();
+}
+
+void Scene::buildLightSelection() {
+    m_hierarchyProbability = 0;
+    if (m_lights.empty()) return;
+
+    // lights at infinity need a finite scene extent to estimate their power
+    Bounds sceneBounds = m_shape->getBoundingBox();
+    if (sceneBounds.isEmpty() || sceneBounds.isUnbounded()) {
+        sceneBounds = Bounds::empty();
+        for (const auto &light : m_lights) {
+            const Bounds bounds = light->getBoundingBox();
+            if (!bounds.isUnbounded()) sceneBounds.extend(bounds);
+        }
+        if (sceneBounds.isEmpty()) sceneBounds = Bounds(Point(-1), Point(+1));
+    }
+
+    const ref<Sampler> rng = std::static_pointer_cast<Sampler>(Registry::create("sampler", "independent", Properties()));
+    rng->seed(0);
+
+    std::vector<float> powers;
+    float totalPower = 0;
+    for (const auto &light : m_lights) {
+        float power = 1;
+        if (m_lightSelection != LightSelection::Uniform) {
+            power = light->power(sceneBounds, *rng);
+            if (!std::isfinite(power) || power < 0) power = 0;
+        }
+        powers.push_back(power);
+        totalPower += power;
+    }
+
+    // estimates can be off (e.g., for textured emitters), so no light is ever starved completely
+    const float minPower = 1e-3f * totalPower / m_lights.size();
+    for (float &power : powers) power = std::max(power, minPower);
+    m_lightTable = AliasTable(powers);
+
+    std::vector<LightBVH::Entry> finiteEntries;
+    std::vector<float> infinitePowers;
+    float infinitePower = 0;
+    for (int i = 0; i < int(m_lights.size()); i++) {
+        const Light *light = m_lights[i].get();
+        const Bounds bounds = light->getBoundingBox();
+        if (bounds.isUnbounded()) {
+            m_lightIndices[light] = { i, int(m_infiniteLights.size()) };
+            m_infiniteLights.push_back(light);
+            infinitePowers.push_back(powers[i]);
+            infinitePower += powers[i];
+        } else {
+            m_lightIndices[light] = { i, int(m_finiteLights.size()) };
+            m_finiteLights.push_back(light);
+            finiteEntries.push_back({ light, bounds, powers[i] });
+        }
+    }
+
+    if (m_lightSelection != LightSelection::Hierarchy) return;
+
+    m_lightHierarchy = std::make_shared<LightBVH>(std::move(finiteEntries));
+    m_infiniteLightTable = AliasTable(infinitePowers);
+    if (m_finiteLights.empty()) {
+        m_hierarchyProbability = 0;
+    } else if (m_infiniteLights.empty()) {
+        m_hierarchyProbability = 1;
+    } else {
+        const float finitePower = m_lightHierarchy->power();
+        m_hierarchyProbability = finitePower + infinitePower > 0 ? finitePower / (finitePower + infinitePower) : 0.5f;
+    }
+    logger(EInfo, "built light hierarchy over %d lights (%d lights at infinity)",
+        m_finiteLights.size(), m_infiniteLights.size());
 }
 
 std::string Scene::toString() const {
@@ -35,13 +115,25 @@ std::string Scene::toString() const {
 
 Intersection Scene::intersect(const Ray &ray, Sampler &rng) const {
     Intersection its(-ray.direction);
-    m_shape->intersect(ray, its, rng);
+    if (m_shape->intersect(ray, its, rng) && its.instance) {
+        // shading data is only computed once the closest hit is known
+        its.instance->computeSurfaceInteraction(ray, its);
+    }
     return its;
 }
 
 bool Scene::intersect(const Ray &ray, float tMax, Sampler &rng) const {
-    Intersection its(-ray.direction, tMax * (1 - Epsilon));
-    return m_shape->intersect(ray, its, rng);
+    return m_shape->occluded(ray, tMax * (1 - Epsilon), rng);
+}
+
+std::vector<const Instance *> Scene::instances() const {
+    std::vector<const Instance *> result;
+    m_shape->collectInstances(result);
+    return result;
+}
+
+float Scene::transmittance(const Ray &ray, float tMax, Sampler &rng) const {
+    return m_shape->transmittance(ray, tMax * (1 - Epsilon), rng);
 }
 
 BackgroundLightEval Scene::evaluateBackground(const Vector &direction) const {
@@ -52,16 +144,49 @@ BackgroundLightEval Scene::evaluateBackground(const Vector &direction) const {
 }
 
 LightSample Scene::sampleLight(Sampler &rng) const {
-    int lightIndex = int(rng.next() * m_lights.size());
-    lightIndex = std::min(lightIndex, int(m_lights.size()) - 1);
+    const int lightIndex = m_lightTable.sample(rng.next());
     return {
         .light = m_lights[lightIndex].get(),
-        .probability = float(1) / m_lights.size(),
+        .probability = m_lightTable.probability(lightIndex),
+    };
+}
+
+LightSample Scene::sampleLight(const Point &origin, Sampler &rng) const {
+    if (m_lightSelection != LightSelection::Hierarchy) return sampleLight(rng);
+
+    const float u = rng.next();
+    if (u < m_hierarchyProbability) {
+        float probability;
+        const int index = m_lightHierarchy->sample(origin, u / m_hierarchyProbability, probability);
+        // the traversal fails if no light in the hierarchy can reach the shading point
+        if (index < 0) return LightSample::invalid();
+        return {
+            .light = m_finiteLights[index],
+            .probability = m_hierarchyProbability * probability,
+        };
+    }
+
+    const int index = m_infiniteLightTable.sample((u - m_hierarchyProbability) / (1 - m_hierarchyProbability));
+    return {
+        .light = m_infiniteLights[index],
+        .probability = (1 - m_hierarchyProbability) * m_infiniteLightTable.probability(index),
     };
 }
 
 float Scene::lightSelectionProbability(const Light *light) const {
-    return float(1) / m_lights.size();
+    const auto it = m_lightIndices.find(light);
+    if (it == m_lightIndices.end()) return 0;
+    return m_lightTable.probability(it->second.first);
+}
+
+float Scene::lightSelectionProbability(const Light *light, const Point &origin) const {
+    if (m_lightSelection != LightSelection::Hierarchy) return lightSelectionProbability(light);
+
+    const auto it = m_lightIndices.find(light);
+    if (it == m_lightIndices.end()) return 0;
+    if (light->getBoundingBox().isUnbounded())
+        return (1 - m_hierarchyProbability) * m_infiniteLightTable.probability(it->second.second);
+    return m_hierarchyProbability * m_lightHierarchy->probability(it->second.second, origin);
 }
 
 Bounds Scene::getBoundingBox() const {
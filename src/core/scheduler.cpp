@@ -0,0 +1,81 @@
+#include "scheduler.hpp"
+
+#include <lightwave/image.hpp>
+#include <lightwave/logger.hpp>
+#include <lightwave/parallel.hpp>
+
+#include <algorithm>
+#include <memory>
+
+namespace lightwave {
+
+static bool sharesImage(const std::vector<ref<Image>> &a, const std::vector<ref<Image>> &b) {
+    for (auto &image : a) {
+        if (std::find(b.begin(), b.end(), image) != b.end())
+            return true;
+    }
+    return false;
+}
+
+Scheduler::Scheduler(const std::vector<ref<Executable>> &executables) {
+    std::vector<std::vector<ref<Image>>> inputs, outputs;
+    for (auto &executable : executables) {
+        m_nodes.push_back({ executable, {}, 0 });
+        inputs.push_back(executable->inputs());
+        outputs.push_back(executable->outputs());
+    }
+
+    int numEdges = 0;
+    for (int later = 0; later < int(m_nodes.size()); later++) {
+        for (int earlier = 0; earlier < later; earlier++) {
+            if (sharesImage(outputs[earlier], inputs[later]) ||
+                sharesImage(outputs[earlier], outputs[later]) ||
+                sharesImage(inputs[earlier], outputs[later])) {
+                m_nodes[earlier].dependents.push_back(later);
+                m_nodes[later].numDependencies++;
+                numEdges++;
+            }
+        }
+    }
+
+    // images that feed other executables are only needed in memory
+    for (int consumer = 0; consumer < int(m_nodes.size()); consumer++) {
+        for (auto &image : inputs[consumer]) {
+            for (int producer = 0; producer < int(m_nodes.size()); producer++) {
+                if (producer != consumer && sharesImage({ image }, outputs[producer]))
+                    image->markIntermediate();
+            }
+        }
+    }
+
+    logger(EDebug, "scheduling %d executables with %d dependencies", m_nodes.size(), numEdges);
+}
+
+void Scheduler::execute() {
+    auto remaining = std::make_unique<std::atomic<int>[]>(m_nodes.size());
+    for (size_t i = 0; i < m_nodes.size(); i++)
+        remaining[i] = m_nodes[i].numDependencies;
+
+    TaskGroup group;
+    std::function<void(int)> launch = [&](int index) {
+        group.run([&, index]() {
+            m_nodes[index].executable->execute();
+
+            // dependents are submitted in reverse, so that the most recently
+            // submitted task (which runs first) is the earliest in the file
+            const auto &dependents = m_nodes[index].dependents;
+            for (auto it = dependents.rbegin(); it != dependents.rend(); ++it) {
+                if (--remaining[*it] == 0)
+                    launch(*it);
+            }
+        });
+    };
+
+    for (int index = int(m_nodes.size()) - 1; index >= 0; index--) {
+        if (m_nodes[index].numDependencies == 0)
+            launch(index);
+    }
+    group.wait();
+}
+
+}
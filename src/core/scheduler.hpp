@@ -0,0 +1,34 @@
+#pragma once
+
+#include <lightwave/core.hpp>
+
+#include <vector>
+
+namespace lightwave {
+
+/**
+ * @brief Runs the executables at the root of a scene file as a dependency graph.
+ * An executable depends on every earlier executable that writes an image it reads or writes, or that reads an image
+ * it writes. Executables without such dependencies run concurrently on the @ref ThreadPool .
+ * Images that are produced by one executable and consumed by another are kept in memory instead of being saved,
+ * unless they are explicitly marked with save="true".
+ */
+class Scheduler {
+    struct Node {
+        ref<Executable> executable;
+        /// @brief The nodes that have to wait for this node to finish.
+        std::vector<int> dependents;
+        /// @brief The number of nodes this node has to wait for.
+        int numDependencies = 0;
+    };
+
+    std::vector<Node> m_nodes;
+
+public:
+    Scheduler(const std::vector<ref<Executable>> &executables);
+
+    /// @brief Executes all nodes, returning once all of them have finished.
+    void execute();
+};
+
+}
@@ -1 +1,3 @@
+// encode and decode the chunks of EXR files in parallel
+#define TINYEXR_USE_THREAD 1
 #include <tinyexr.cc>
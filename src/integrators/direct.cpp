@@ -5,6 +5,7 @@ namespace lightwave {
     class DirectIntegrator : public SamplingIntegrator {
     public:
         DirectIntegrator(const Properties &properties) : SamplingIntegrator(properties) {
+            m_mis = integrators::getMisHeuristic(properties);
         }
 
         Color Li(const Ray &ray, Sampler &rng) override {
@@ -14,31 +15,48 @@ namespace lightwave {
             Color weight = Color(1.0f);
             Color Li = Color(0.f);
             bool useLights = m_scene->hasLights();
+            const auto mis = useLights ? m_mis : integrators::MisHeuristic::None;
+
+            Point previousPosition = ray.origin;
+            float bsdfPdf = Infinity;
 
             for (int i = 0; i < DEPTH; i++) {
                 const Intersection its = m_scene->intersect(currentRay, rng);
 
                 // Hit nothing, early exit
                 if (!its) {
-                    Li += m_scene->evaluateBackground(currentRay.direction).value * weight;
+                    const float misWeight = integrators::misWeightForHit(
+                        m_scene, mis, previousPosition, bsdfPdf, m_scene->background(), its);
+                    Li += m_scene->evaluateBackground(currentRay.direction).value * weight * misWeight;
                     return Li;
                 }
 
-                Li += its.evaluateEmission() * weight;
+                const Color emission = its.evaluateEmission();
+                if (emission != Color(0)) {
+                    const float misWeight = integrators::misWeightForHit(
+                        m_scene, mis, previousPosition, bsdfPdf, its.instance->light(), its);
+                    Li += emission * weight * misWeight;
+                }
                 // Return early for direct integrator
                 if (i == DEPTH - 1) return Li;
 
-                if (useLights) Li += lightwave::integrators::resolveNEEContribution(m_scene, rng, its, weight);
+                if (useLights) Li += lightwave::integrators::resolveNEEContribution(m_scene, rng, its, weight, mis);
                     
                 BsdfSample sample = its.sampleBsdf(rng);
                 weight *= sample.weight;
 
                 currentRay = Ray(its.position, sample.wi.normalized());
+                previousPosition = its.position;
+                bsdfPdf = sample.pdf;
             }
 
             return Li;
         }
 
+    private:
+        integrators::MisHeuristic m_mis;
+
+    public:
         std::string toString() const override {
             return tfm::format(
                 "DirectIntegrator[\n"
@@ -1,4 +1,6 @@
 #include <lightwave.hpp>
+#include "sdtree.hpp"
+#include "shadowcache.hpp"
 #include "utils.hpp"
 
 namespace lightwave {
@@ -7,62 +9,232 @@ namespace lightwave {
         PathTracerIntegrator(const Properties &properties) : SamplingIntegrator(properties) {
             m_depth = properties.get<int>("depth", 2);
             m_useNEE = properties.get<bool>("nee", true);
+            m_mis = integrators::getMisHeuristic(properties);
+            m_guiding = properties.get<bool>("guiding", false);
+            m_trainingPasses = properties.get<int>("trainingPasses", 5);
+            m_spatialThreshold = properties.get<float>("spatialThreshold", 2000);
+            // a small share of Bsdf samples is kept so that specular components remain reachable
+            m_bsdfSamplingFraction = std::clamp(properties.get<float>("bsdfSamplingFraction", 0.5f), 0.05f, 1.f);
+            m_shadowCacheResolution = properties.get<int>("shadowCache", 0);
+            m_shadowCacheSamples = std::max(properties.get<int>("shadowCacheSamples", 4), 1);
+        }
+
+        void execute() override {
+            if (m_shadowCacheResolution > 0 && m_useNEE && !m_shadowCache) {
+                m_shadowCache = std::make_unique<integrators::ShadowCache>(
+                    m_scene, *m_sampler, m_shadowCacheResolution, m_shadowCacheSamples);
+            }
+            if (m_guiding) train();
+            SamplingIntegrator::execute();
         }
 
         Color Li(const Ray &ray, Sampler &rng) override {
+            return trace(ray, rng, nullptr, false);
+        }
+
+        Color LiWithFirstHit(const Ray &ray, Sampler &rng, FirstHit &firstHit) override {
+            return trace(ray, rng, &firstHit, false);
+        }
+
+        std::string toString() const override {
+            return tfm::format(
+                "PathTracerIntegrator[\n"
+                "  sampler = %s,\n"
+                "  image = %s,\n"
+                "  depth = %d,\n"
+                "  guiding = %s,\n"
+                "]",
+                indent(m_sampler),
+                indent(m_image),
+                indent(m_depth),
+                indent(m_guiding)
+            );
+        }
+
+    private:
+        int m_depth;
+        bool m_useNEE;
+        integrators::MisHeuristic m_mis;
+        /// @brief Whether directions are sampled from a distribution of the incident radiance that is learned in
+        /// training passes before rendering.
+        bool m_guiding;
+        /// @brief The number of training passes, each of which takes twice as many samples as the previous one.
+        int m_trainingPasses;
+        /// @brief The number of records (per square root of the samples per pixel of a pass) after which a region of
+        /// space is split.
+        float m_spatialThreshold;
+        /// @brief The probability of sampling the Bsdf instead of the learned distribution.
+        float m_bsdfSamplingFraction;
+        std::unique_ptr<integrators::SDTree> m_sdTree;
+        /// @brief The number of vertices along each axis of the transmittance grids baked for volumes (0 disables
+        /// the cache).
+        int m_shadowCacheResolution;
+        /// @brief The number of transmittance estimates averaged for every vertex of the cache.
+        int m_shadowCacheSamples;
+        std::unique_ptr<integrators::ShadowCache> m_shadowCache;
+
+        /// @brief A scattering event of a training path, whose incident radiance is recorded once the path is done.
+        struct GuidingVertex {
+            integrators::SDTree::Region *region;
+            Vector direction;
+            /// @brief The density with which the direction has been sampled.
+            float pdf;
+            /// @brief The path weight after scattering, which converts contributions of the path into radiance
+            /// arriving at this vertex.
+            Color throughput;
+            Color radiance;
+
+            void add(const Color &contribution) {
+                for (int channel = 0; channel < 3; channel++) {
+                    if (throughput[channel] > 0) radiance[channel] += contribution[channel] / throughput[channel];
+                }
+            }
+        };
+
+        /// @brief Learns the incident radiance in passes of doubling sample counts, refining the tree after each.
+        void train() {
+            Bounds bounds = m_scene->getBoundingBox();
+            if (bounds.isEmpty() || bounds.isUnbounded()) bounds = Bounds(Point(-1), Point(+1));
+            m_sdTree = std::make_unique<integrators::SDTree>(bounds, m_spatialThreshold, 0.01f, 20);
+
+            const Vector2i resolution = m_scene->camera()->resolution();
+            // training samples continue after the samples of the final render, so that both are uncorrelated
+            int sampleOffset = m_sampler->samplesPerPixel();
+            for (int pass = 0; pass < m_trainingPasses; pass++) {
+                const int passSamples = 1 << pass;
+                Timer timer;
+                for_each_parallel(BlockSpiral(resolution, Vector2i(64)), [&](auto block) {
+                    auto sampler = m_sampler->clone();
+                    for (auto pixel : block) {
+                        for (int sample = 0; sample < passSamples; sample++) {
+                            sampler->seed(pixel, sampleOffset + sample);
+                            const auto cameraSample = m_scene->camera()->sample(pixel, *sampler);
+                            trace(cameraSample.ray, *sampler, nullptr, true);
+                        }
+                    }
+                });
+                sampleOffset += passSamples;
+                m_sdTree->refine(passSamples);
+
+                logger(EInfo, "guiding pass %d/%d with %d samples per pixel took %.1fs, %d regions", pass + 1,
+                       m_trainingPasses, passSamples, timer.getElapsedTime(), m_sdTree->numRegions());
+            }
+        }
+
+        /// @brief Returns the density of sampling a direction with the mixture of Bsdf and learned distribution.
+        float scatterPdf(const Intersection &its, const integrators::DirectionalTree *guide, const Vector &wi) const {
+            const float bsdfPdf = its.pdfBsdf(wi);
+            if (!guide) return bsdfPdf;
+            return m_bsdfSamplingFraction * bsdfPdf + (1 - m_bsdfSamplingFraction) * guide->pdf(wi);
+        }
+
+        /// @brief Samples either the Bsdf or the learned distribution, weighted by their mixture (one-sample MIS).
+        BsdfSample sampleGuided(const Intersection &its, const integrators::DirectionalTree &guide,
+                                Sampler &rng) const {
+            Vector wi;
+            if (rng.next() < m_bsdfSamplingFraction) {
+                BsdfSample sample = its.sampleBsdf(rng);
+                if (sample.isInvalid()) return sample;
+                if (sample.isSpecular()) {
+                    // only the Bsdf can produce specular directions
+                    sample.weight /= m_bsdfSamplingFraction;
+                    return sample;
+                }
+                wi = sample.wi;
+            } else {
+                wi = guide.sample(rng.next2D());
+            }
+
+            // the weight of a Bsdf sample may only account for the lobe that has been picked (e.g., principled), hence
+            // the Bsdf is evaluated as a whole for either strategy
+            const Color value = its.evaluateBsdf(wi).value;
+            const float pdf = scatterPdf(its, &guide, wi);
+            if (!(pdf > 0) || value == Color(0)) return BsdfSample::invalid();
+            return { wi, value / pdf, pdf };
+        }
+
+        Color trace(const Ray &ray, Sampler &rng, FirstHit *firstHit, bool train) {
             Ray currentRay = ray;
             Color weight = Color(1.0f);
             Color Li = Color(0.f);
             bool useLights = m_scene->hasLights();
+            // without light sampling, all emission has to be found through Bsdf sampling
+            const auto mis = m_useNEE && useLights ? m_mis : integrators::MisHeuristic::None;
+
+            // camera rays cannot be reproduced by light sampling, hence are treated like specular events
+            Point previousPosition = ray.origin;
+            float bsdfPdf = Infinity;
+
+            std::vector<GuidingVertex> vertices;
+            const auto contribute = [&](const Color &contribution) {
+                Li += contribution;
+                for (auto &vertex : vertices) vertex.add(contribution);
+            };
 
             for (int i = 0; i < m_depth; i++) {
                 Intersection its = m_scene->intersect(currentRay, rng);
+                if (i == 0 && firstHit) *firstHit = FirstHit(its);
 
                 if (!its) {
-                    Li += m_scene->evaluateBackground(currentRay.direction).value * weight;
-                    return Li;
+                    const float misWeight = integrators::misWeightForHit(
+                        m_scene, mis, previousPosition, bsdfPdf, m_scene->background(), its);
+                    contribute(m_scene->evaluateBackground(currentRay.direction).value * weight * misWeight);
+                    break;
                 }
 
-                Li += its.evaluateEmission() * weight;
+                const Color emission = its.evaluateEmission();
+                if (emission != Color(0)) {
+                    const float misWeight = integrators::misWeightForHit(
+                        m_scene, mis, previousPosition, bsdfPdf, its.instance->light(), its);
+                    contribute(emission * weight * misWeight);
+                }
 
                 // Exit early when max depth is reached
                 if (i == m_depth - 1) {
-                    return Li;
+                    break;
                 }
-                
-                if (m_useNEE && useLights) Li += lightwave::integrators::resolveNEEContribution(m_scene, rng, its, weight);
 
-                BsdfSample sample = its.sampleBsdf(rng);
+                // specular surfaces cannot make use of guiding
+                integrators::SDTree::Region *region = nullptr;
+                if (m_sdTree && its.instance->bsdf() && !its.instance->bsdf()->isSpecular())
+                    region = &m_sdTree->lookup(its.position);
+                const integrators::DirectionalTree *guide =
+                    region && region->sampling.total() > 0 ? &region->sampling : nullptr;
+
+                if (m_useNEE && useLights) {
+                    contribute(integrators::resolveNEEContribution(m_scene, rng, its, weight, mis,
+                        [&](const Vector &wi) { return scatterPdf(its, guide, wi); },
+                        [&](const Light *light, const DirectLightSample &lightSample, const Ray &lightRay) {
+                            float transmittance;
+                            if (m_shadowCache && m_shadowCache->lookup(its.instance, light, its.position, transmittance))
+                                return transmittance;
+                            return m_scene->transmittance(lightRay, lightSample.distance, rng);
+                        }));
+                }
+
+                BsdfSample sample = guide ? sampleGuided(its, *guide, rng) : its.sampleBsdf(rng);
                 weight *= sample.weight;
                 
                 // Exit if sample is invalid (usually just black)
                 if (sample.isInvalid()) {
-                    return Li;
+                    break;
                 }
 
                 currentRay = Ray(its.position, sample.wi.normalized());
+                previousPosition = its.position;
+                bsdfPdf = sample.pdf;
+
+                if (train && region && !sample.isSpecular())
+                    vertices.push_back({ region, currentRay.direction, sample.pdf, weight, Color(0) });
             }
 
+            for (const auto &vertex : vertices) {
+                const float value = vertex.radiance.mean() / vertex.pdf;
+                if (std::isfinite(value) && value >= 0) vertex.region->building.record(vertex.direction, value);
+            }
             return Li;
         }
-
-        std::string toString() const override {
-            return tfm::format(
-                "PathTracerIntegrator[\n"
-                "  sampler = %s,\n"
-                "  image = %s,\n"
-                "  depth = %d,\n"
-                "]",
-                indent(m_sampler),
-                indent(m_image),
-                indent(m_depth)
-            );
-        }
-
-    private:
-        int m_depth;
-        bool m_useNEE;
     };
 }
 
-REGISTER_INTEGRATOR(PathTracerIntegrator, "pathtracer");
\ No newline at end of file
+REGISTER_INTEGRATOR(PathTracerIntegrator, "pathtracer");
@@ -0,0 +1,308 @@
+#pragma once
+
+#include <lightwave.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace lightwave::integrators {
+
+    /**
+     * @brief A piecewise constant distribution over the sphere of directions, represented by a quadtree over the
+     * square that @ref squareToUniformSphere maps to the sphere (which preserves areas, hence densities on the square
+     * are proportional to solid angle densities).
+     * Every node stores the energy of each of its four quadrants, which are either leaves or further subdivided.
+     * @note Recording is thread-safe as long as the structure of the tree does not change.
+     */
+    class DirectionalTree {
+        struct Node {
+            /// @brief The energy recorded within each quadrant.
+            std::array<std::atomic<float>, 4> sums;
+            /// @brief The node each quadrant is subdivided into, or 0 for leaves (the root is never a child).
+            std::array<uint32_t, 4> children {};
+
+            Node() {
+                for (auto &sum : sums) sum.store(0, std::memory_order_relaxed);
+            }
+
+            Node(const Node &other) : children(other.children) {
+                for (int i = 0; i < 4; i++) sums[i].store(other.sum(i), std::memory_order_relaxed);
+            }
+
+            Node &operator=(const Node &other) {
+                children = other.children;
+                for (int i = 0; i < 4; i++) sums[i].store(other.sum(i), std::memory_order_relaxed);
+                return *this;
+            }
+
+            float sum(int child) const { return sums[child].load(std::memory_order_relaxed); }
+            float total() const { return sum(0) + sum(1) + sum(2) + sum(3); }
+            bool isLeaf(int child) const { return children[child] == 0; }
+        };
+
+        std::vector<Node> m_nodes;
+        /// @brief The number of records that have been made.
+        std::atomic<uint64_t> m_records;
+
+        /// @brief The largest float below one, used to keep remapped random numbers in [0,1).
+        static constexpr float OneMinusEpsilon = 0x1.fffffep-1f;
+
+        /// @brief Returns the quadrant a point lies in and remaps the point to the coordinates of that quadrant.
+        static int descend(Point2 &point) {
+            int child = 0;
+            for (int dim = 0; dim < 2; dim++) {
+                if (point[dim] < 0.5f) {
+                    point[dim] *= 2;
+                } else {
+                    point[dim] = std::min(2 * point[dim] - 1, OneMinusEpsilon);
+                    child |= 1 << dim;
+                }
+            }
+            return child;
+        }
+
+    public:
+        DirectionalTree() : m_nodes(1), m_records(0) {}
+
+        DirectionalTree(const DirectionalTree &other) : m_nodes(other.m_nodes), m_records(other.records()) {}
+
+        DirectionalTree &operator=(const DirectionalTree &other) {
+            m_nodes = other.m_nodes;
+            m_records.store(other.records(), std::memory_order_relaxed);
+            return *this;
+        }
+
+        /// @brief Returns the total energy recorded in the tree.
+        float total() const { return m_nodes.front().total(); }
+        /// @brief Returns the number of records that have been made.
+        uint64_t records() const { return m_records.load(std::memory_order_relaxed); }
+        /// @brief Overrides the number of records, e.g., when the tree is shared with another region of space.
+        void setRecords(uint64_t records) { m_records.store(records, std::memory_order_relaxed); }
+
+        /// @brief Adds energy that has been observed for a direction to all nodes containing it.
+        void record(const Vector &direction, float value) {
+            m_records.fetch_add(1, std::memory_order_relaxed);
+            Point2 point = uniformSphereToSquare(direction);
+            uint32_t node = 0;
+            while (true) {
+                const int child = descend(point);
+                m_nodes[node].sums[child].fetch_add(value, std::memory_order_relaxed);
+                if (m_nodes[node].isLeaf(child)) return;
+                node = m_nodes[node].children[child];
+            }
+        }
+
+        /// @brief Returns the solid angle density of sampling the given direction.
+        float pdf(const Vector &direction) const {
+            Point2 point = uniformSphereToSquare(direction);
+            float density = 1;
+            uint32_t node = 0;
+            while (true) {
+                const float total = m_nodes[node].total();
+                if (!(total > 0)) break;
+                const int child = descend(point);
+                density *= 4 * m_nodes[node].sum(child) / total;
+                if (m_nodes[node].isLeaf(child)) break;
+                node = m_nodes[node].children[child];
+            }
+            return density * Inv4Pi;
+        }
+
+        /// @brief Samples a direction proportionally to the recorded energy (see @ref pdf for its density).
+        Vector sample(Point2 u) const {
+            Point2 origin(0);
+            float size = 1;
+            uint32_t node = 0;
+            while (true) {
+                const Node &current = m_nodes[node];
+                const float total = current.total();
+                if (!(total > 0)) break;
+
+                // pick the column first, then the quadrant within it
+                const float leftProbability = (current.sum(0) + current.sum(2)) / total;
+                int column = 0;
+                if (u.x() < leftProbability) {
+                    u.x() = std::min(u.x() / leftProbability, OneMinusEpsilon);
+                } else {
+                    u.x() = std::min((u.x() - leftProbability) / (1 - leftProbability), OneMinusEpsilon);
+                    column = 1;
+                }
+
+                const float columnTotal = current.sum(column) + current.sum(column + 2);
+                const float lowerProbability = columnTotal > 0 ? current.sum(column) / columnTotal : 0.5f;
+                int row = 0;
+                if (u.y() < lowerProbability) {
+                    u.y() = std::min(u.y() / lowerProbability, OneMinusEpsilon);
+                } else {
+                    u.y() = std::min((u.y() - lowerProbability) / (1 - lowerProbability), OneMinusEpsilon);
+                    row = 1;
+                }
+
+                size /= 2;
+                origin += Vector2(column * size, row * size);
+
+                const int child = column + 2 * row;
+                if (current.isLeaf(child)) break;
+                node = current.children[child];
+            }
+            return squareToUniformSphere(Point2(origin.x() + u.x() * size, origin.y() + u.y() * size));
+        }
+
+        /**
+         * @brief Creates an empty tree whose structure adapts to the energy learned by another tree: quadrants that
+         * hold more than the given fraction of the total energy are subdivided, all others are collapsed.
+         */
+        static DirectionalTree refined(const DirectionalTree &learned, float threshold, int maxDepth) {
+            const float total = learned.total();
+            if (!(total > 0)) {
+                // nothing has been learned, keep the previous structure
+                DirectionalTree result;
+                result.m_nodes = learned.m_nodes;
+                for (auto &node : result.m_nodes)
+                    for (auto &sum : node.sums) sum.store(0, std::memory_order_relaxed);
+                return result;
+            }
+
+            struct Entry {
+                uint32_t node;
+                /// @brief The corresponding node of the learned tree, or -1 if it has not been subdivided that far.
+                int learnedNode;
+                float energy;
+                int depth;
+            };
+
+            DirectionalTree result;
+            std::vector<Entry> stack = { { 0, 0, total, 1 } };
+            while (!stack.empty()) {
+                const Entry entry = stack.back();
+                stack.pop_back();
+
+                for (int child = 0; child < 4; child++) {
+                    int learnedChild = -1;
+                    float energy = entry.energy / 4;
+                    if (entry.learnedNode >= 0) {
+                        const Node &learnedNode = learned.m_nodes[entry.learnedNode];
+                        energy = learnedNode.sum(child);
+                        if (!learnedNode.isLeaf(child)) learnedChild = int(learnedNode.children[child]);
+                    }
+
+                    if (entry.depth >= maxDepth || !(energy > threshold * total)) continue;
+
+                    const uint32_t index = uint32_t(result.m_nodes.size());
+                    result.m_nodes.emplace_back();
+                    result.m_nodes[entry.node].children[child] = index;
+                    stack.push_back({ index, learnedChild, energy, entry.depth + 1 });
+                }
+            }
+            return result;
+        }
+    };
+
+    /**
+     * @brief A spatio-directional tree (following Müller et al., "Practical Path Guiding for Efficient
+     * Light-Transport Simulation"), i.e., a binary tree over the scene bounds whose leaves hold directional
+     * distributions of the incident radiance.
+     * Every region holds one distribution that is used for sampling and one that records new observations, which
+     * replaces the former whenever the tree is refined after a training pass.
+     */
+    class SDTree {
+    public:
+        /// @brief A leaf of the spatial tree.
+        struct Region {
+            /// @brief The distribution learned in previous passes, used for sampling.
+            DirectionalTree sampling;
+            /// @brief The distribution that records the current pass.
+            DirectionalTree building;
+        };
+
+        /**
+         * @param bounds The region of space covered by the tree (points outside are clamped to it).
+         * @param spatialThreshold The number of records (per square root of the samples per pixel of a pass) after
+         * which a region is split in half.
+         * @param directionalThreshold The fraction of energy above which a quadrant of a directional tree is
+         * subdivided.
+         * @param maxDepth The maximum depth of the directional trees.
+         */
+        SDTree(const Bounds &bounds, float spatialThreshold, float directionalThreshold, int maxDepth)
+            : m_bounds(bounds), m_spatialThreshold(spatialThreshold),
+              m_directionalThreshold(directionalThreshold), m_maxDepth(maxDepth) {
+            m_nodes.push_back({ 0, 0, 0 });
+            m_regions.emplace_back();
+        }
+
+        /// @brief Returns the region containing a point.
+        Region &lookup(const Point &position) {
+            const Vector extent = m_bounds.diagonal();
+            Point point;
+            for (int dim = 0; dim < 3; dim++)
+                point[dim] = std::clamp((position[dim] - m_bounds.min()[dim]) / extent[dim], 0.f, 1.f);
+
+            uint32_t node = 0;
+            while (m_nodes[node].children) {
+                const int axis = m_nodes[node].axis;
+                if (point[axis] < 0.5f) {
+                    point[axis] *= 2;
+                    node = m_nodes[node].children;
+                } else {
+                    point[axis] = 2 * point[axis] - 1;
+                    node = m_nodes[node].children + 1;
+                }
+            }
+            return m_regions[m_nodes[node].region];
+        }
+
+        /// @brief Returns the number of regions the scene is split into.
+        int numRegions() const { return int(m_regions.size()); }
+
+        /**
+         * @brief Makes the distributions recorded in the last pass available for sampling, splits regions that have
+         * received many records and adapts the structure of the directional trees to what has been learned.
+         * @param passSamples The number of samples per pixel of the pass that has just been completed.
+         */
+        void refine(int passSamples) {
+            for (auto &region : m_regions)
+                region.sampling = region.building;
+
+            // regions are split in half (alternating axes) until the records are spread thinly enough
+            const uint64_t threshold = uint64_t(m_spatialThreshold * std::sqrt(float(passSamples)));
+            for (uint32_t node = 0; node < m_nodes.size(); node++) {
+                if (m_nodes[node].children) continue;
+                const uint32_t regionIndex = m_nodes[node].region;
+                const uint64_t records = m_regions[regionIndex].building.records();
+                if (records <= threshold) continue;
+
+                // both halves start out with the distributions of their parent
+                m_regions[regionIndex].building.setRecords(records / 2);
+                m_regions.push_back(m_regions[regionIndex]);
+
+                const uint8_t axis = (m_nodes[node].axis + 1) % 3;
+                const uint32_t children = uint32_t(m_nodes.size());
+                m_nodes[node].children = children;
+                m_nodes.push_back({ 0, regionIndex, axis });
+                m_nodes.push_back({ 0, uint32_t(m_regions.size() - 1), axis });
+            }
+
+            for (auto &region : m_regions)
+                region.building = DirectionalTree::refined(region.sampling, m_directionalThreshold, m_maxDepth);
+        }
+
+    private:
+        struct Node {
+            /// @brief The index of the first of two consecutive children, or 0 for leaves.
+            uint32_t children;
+            /// @brief For leaves, the region they hold.
+            uint32_t region;
+            /// @brief The axis along which the node is split.
+            uint8_t axis;
+        };
+
+        Bounds m_bounds;
+        float m_spatialThreshold;
+        float m_directionalThreshold;
+        int m_maxDepth;
+        std::vector<Node> m_nodes;
+        std::vector<Region> m_regions;
+    };
+}
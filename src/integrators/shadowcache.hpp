@@ -0,0 +1,143 @@
+#pragma once
+
+#include <lightwave.hpp>
+
+#include <unordered_map>
+#include <vector>
+
+namespace lightwave::integrators {
+
+    /**
+     * @brief Precomputed transmittance towards lights that illuminate every point from a single direction (e.g.,
+     * point, spot and directional lights), stored in a regular grid over the bounds of every volume instance (also
+     * known as deep shadow map). Next event estimation within volumes can then replace tracking shadow rays through
+     * the scene by a single trilinear lookup.
+     * @note Lookups are biased, as they blur the transmittance over the extent of a grid cell. The bias vanishes
+     * with increasing resolution.
+     */
+    class ShadowCache {
+        /// @brief The cached transmittance of a volume instance.
+        struct Entry {
+            /// @brief The transformation of the instance (can be null for the identity).
+            const Transform *transform;
+            /// @brief The region of object space that the grid spans.
+            Bounds bounds;
+            /// @brief For every cached light, the transmittance at all vertices of the grid (x fastest).
+            std::vector<std::vector<float>> lights;
+        };
+
+        int m_resolution;
+        /// @brief Maps every cached light to its index within @ref Entry::lights .
+        std::unordered_map<const Light *, int> m_lightIndices;
+        std::unordered_map<const Instance *, Entry> m_entries;
+
+        size_t vertexIndex(int x, int y, int z) const {
+            return (size_t(z) * m_resolution + y) * m_resolution + x;
+        }
+
+        /// @brief Estimates the transmittance from every vertex of the grid of an instance towards a light.
+        std::vector<float> bake(const ref<Scene> &scene, const Sampler &prototype, const Entry &entry,
+                                const Light &light, int samples) const {
+            std::vector<float> values(size_t(m_resolution) * m_resolution * m_resolution);
+            const Vector extent = entry.bounds.diagonal() / float(m_resolution - 1);
+            parallel_for(0, m_resolution, [&](int z) {
+                auto sampler = prototype.clone();
+                for (int y = 0; y < m_resolution; y++) {
+                    for (int x = 0; x < m_resolution; x++) {
+                        const size_t index = vertexIndex(x, y, z);
+                        sampler->seed(int(index));
+
+                        Point position = entry.bounds.min() + Vector(x * extent.x(), y * extent.y(), z * extent.z());
+                        if (entry.transform) position = entry.transform->apply(position);
+
+                        const DirectLightSample sample = light.sampleDirect(position, *sampler);
+                        if (sample.isInvalid()) {
+                            // the light does not reach this point, lookups will not happen
+                            values[index] = 1;
+                            continue;
+                        }
+
+                        float sum = 0;
+                        for (int i = 0; i < samples; i++)
+                            sum += scene->transmittance(Ray(position, sample.wi), sample.distance, *sampler);
+                        values[index] = sum / samples;
+                    }
+                }
+            });
+            return values;
+        }
+
+    public:
+        /**
+         * @param prototype The sampler that is cloned to estimate the transmittance.
+         * @param resolution The number of vertices of the grid along each axis.
+         * @param samples The number of transmittance estimates that are averaged for every vertex.
+         */
+        ShadowCache(const ref<Scene> &scene, const Sampler &prototype, int resolution, int samples)
+            : m_resolution(std::max(resolution, 2)) {
+            Timer timer;
+
+            // only lights that are sampled with a single direction per point can be cached
+            std::vector<const Light *> lights;
+            const Point center = scene->getBoundingBox().center();
+            auto sampler = prototype.clone();
+            for (const auto &light : scene->lights()) {
+                sampler->seed(0);
+                if (light->canBeIntersected() || light->sampleDirect(center, *sampler).pdf != Infinity) continue;
+                m_lightIndices[light.get()] = int(lights.size());
+                lights.push_back(light.get());
+            }
+            if (lights.empty()) return;
+
+            for (const Instance *instance : scene->instances()) {
+                if (!instance->volume()) continue;
+
+                Entry entry { instance->transform(), instance->shape()->getBoundingBox(), {} };
+                const Vector diagonal = entry.bounds.diagonal();
+                if (entry.bounds.isUnbounded() || !(diagonal.x() > 0 && diagonal.y() > 0 && diagonal.z() > 0))
+                    continue;
+                for (const Light *light : lights)
+                    entry.lights.push_back(bake(scene, prototype, entry, *light, samples));
+                m_entries.emplace(instance, std::move(entry));
+            }
+
+            logger(EInfo, "baked shadows of %d volumes towards %d lights (%d^3 vertices) in %.1fs",
+                   int(m_entries.size()), int(lights.size()), m_resolution, timer.getElapsedTime());
+        }
+
+        /**
+         * @brief Looks up the transmittance from a point within a volume instance towards a light.
+         * @return @c false if the transmittance has not been cached, i.e., needs to be estimated by tracing.
+         */
+        bool lookup(const Instance *instance, const Light *light, const Point &position, float &transmittance) const {
+            const auto lightIt = m_lightIndices.find(light);
+            if (lightIt == m_lightIndices.end()) return false;
+            const auto entryIt = m_entries.find(instance);
+            if (entryIt == m_entries.end()) return false;
+
+            const Entry &entry = entryIt->second;
+            const Point local = entry.transform ? entry.transform->inverse(position) : position;
+            const Vector diagonal = entry.bounds.diagonal();
+
+            int cell[3];
+            float fraction[3];
+            for (int dim = 0; dim < 3; dim++) {
+                const float coordinate = std::clamp(
+                    (local[dim] - entry.bounds.min()[dim]) / diagonal[dim] * (m_resolution - 1), 0.f,
+                    float(m_resolution - 1));
+                cell[dim] = std::min(int(coordinate), m_resolution - 2);
+                fraction[dim] = coordinate - cell[dim];
+            }
+
+            const std::vector<float> &values = entry.lights[lightIt->second];
+            transmittance = 0;
+            for (int i = 0; i < 8; i++) {
+                const int dx = i & 1, dy = (i >> 1) & 1, dz = i >> 2;
+                const float weight = (dx ? fraction[0] : 1 - fraction[0]) * (dy ? fraction[1] : 1 - fraction[1]) *
+                                     (dz ? fraction[2] : 1 - fraction[2]);
+                transmittance += weight * values[vertexIndex(cell[0] + dx, cell[1] + dy, cell[2] + dz)];
+            }
+            return true;
+        }
+    };
+}
@@ -4,19 +4,95 @@
 
 namespace lightwave::integrators {
 
-    inline Color resolveNEEContribution(const ref<Scene> &scene, Sampler &rng, const Intersection &its, const Color &weight) {
-        auto [ light, probability ] = scene->sampleLight(rng);
+    /// @brief How light sampling and Bsdf sampling are combined for lights that both techniques can reach.
+    enum class MisHeuristic {
+        /// @brief Intersectable lights are only found through Bsdf sampling.
+        None,
+        /// @brief Weights are proportional to the densities of the techniques.
+        Balance,
+        /// @brief Weights are proportional to the squared densities of the techniques.
+        Power,
+    };
+
+    inline MisHeuristic getMisHeuristic(const Properties &properties) {
+        return properties.getEnum<MisHeuristic>("mis", MisHeuristic::Power, {
+            { "none", MisHeuristic::None },
+            { "balance", MisHeuristic::Balance },
+            { "power", MisHeuristic::Power },
+        });
+    }
+
+    /**
+     * @brief Returns the weight of a sample that has been drawn with density @c pdf , when another technique could
+     * have produced it with density @c otherPdf .
+     * @note Computed from the ratio of the densities, which avoids overflows for very peaked distributions.
+     */
+    inline float misWeight(MisHeuristic heuristic, float pdf, float otherPdf) {
+        if (pdf == Infinity || heuristic == MisHeuristic::None) return 1;
+        if (pdf == 0) return 0;
+        const float ratio = otherPdf / pdf;
+        return heuristic == MisHeuristic::Power ? 1 / (1 + sqr(ratio)) : 1 / (1 + ratio);
+    }
+
+    /**
+     * @brief Returns the weight of emission that has been found through Bsdf sampling, given that light sampling
+     * could also have found it.
+     * @param origin The point the Bsdf has been sampled at.
+     * @param bsdfPdf The solid angle density of the Bsdf sample.
+     * @param light The light that has been hit (can be null for emissive objects that are not lights).
+     * @param its The intersection with the light, or the escaped ray for lights at infinity.
+     */
+    inline float misWeightForHit(const ref<Scene> &scene, MisHeuristic heuristic, const Point &origin,
+                                 float bsdfPdf, const Light *light, const Intersection &its) {
+        if (heuristic == MisHeuristic::None || !light) return 1;
+        const float lightPdf = scene->lightSelectionProbability(light, origin) * light->pdf(origin, its);
+        return misWeight(heuristic, bsdfPdf, lightPdf);
+    }
+
+    /**
+     * @brief Samples a light and returns its contribution to the given intersection.
+     * @param scatterPdf Returns the density with which the integrator would sample a direction (by default, the
+     * density of the Bsdf), against which the light sample is weighted.
+     * @param transmittance Returns the fraction of light that arrives from the sampled light, given the light, the
+     * light sample and the shadow ray (by default, estimated by tracing the shadow ray through the scene).
+     */
+    template <typename ScatterPdf, typename Transmittance>
+    inline Color resolveNEEContribution(const ref<Scene> &scene, Sampler &rng, const Intersection &its, const Color &weight,
+                                        MisHeuristic heuristic, ScatterPdf &&scatterPdf, Transmittance &&transmittance) {
+        auto [ light, probability ] = scene->sampleLight(its.position, rng);
+        if (!light) return Color(0.f);
         DirectLightSample lightSample = light->sampleDirect(its.position, rng);
-        if (light->canBeIntersected()) {
-            // Ignore intersectable lights for now
+        if (light->canBeIntersected() && heuristic == MisHeuristic::None) {
+            // Intersectable lights are left to Bsdf sampling
             return Color(0.f);
-        } 
-        
+        }
+        if (lightSample.isInvalid()) return Color(0.f);
+
         const Ray lightRay = Ray(its.position, lightSample.wi);
-        // Check if we can reach the light
-        if (!scene->intersect(lightRay, lightSample.distance, rng)) {
-            return weight * its.evaluateBsdf(lightSample.wi).value * lightSample.weight / probability;
+        // Check how much light reaches us (participating media may let some of it through)
+        const float visibility = transmittance(light, lightSample, lightRay);
+        if (visibility == 0) return Color(0.f);
+
+        Color contribution = visibility * weight * its.evaluateBsdf(lightSample.wi).value * lightSample.weight / probability;
+        if (light->canBeIntersected()) {
+            // Bsdf sampling could also have found this light
+            contribution *= misWeight(heuristic, probability * lightSample.pdf, scatterPdf(lightSample.wi));
         }
-        return Color(0.f);
+        return contribution;
+    }
+
+    template <typename ScatterPdf>
+    inline Color resolveNEEContribution(const ref<Scene> &scene, Sampler &rng, const Intersection &its, const Color &weight,
+                                        MisHeuristic heuristic, ScatterPdf &&scatterPdf) {
+        return resolveNEEContribution(scene, rng, its, weight, heuristic, std::forward<ScatterPdf>(scatterPdf),
+                                      [&](const Light *, const DirectLightSample &lightSample, const Ray &lightRay) {
+                                          return scene->transmittance(lightRay, lightSample.distance, rng);
+                                      });
+    }
+
+    inline Color resolveNEEContribution(const ref<Scene> &scene, Sampler &rng, const Intersection &its, const Color &weight,
+                                        MisHeuristic heuristic = MisHeuristic::None) {
+        return resolveNEEContribution(scene, rng, its, weight, heuristic,
+                                      [&](const Vector &wi) { return its.pdfBsdf(wi); });
     }
-}
\ No newline at end of file
+}
@@ -21,24 +21,44 @@ class AreaLight final : public Light {
 public:
     AreaLight(const Properties &properties) {
         m_instance = properties.getChild<Instance>();
+        m_instance->setLight(this);
     }
 
     DirectLightSample sampleDirect(const Point &origin, Sampler &rng) const override {
-        const AreaSample sample = m_instance->sampleArea(rng);
+        // the density of the sample is given in solid angle
+        const AreaSample sample = m_instance->sampleSolidAngle(origin, rng);
         auto [length, wi] = (sample.position - origin).lengthAndNormalized();
 
         if (sample.pdf == 0.f || length == 0.f) return DirectLightSample::invalid();
 
-        const Vector localWi = sample.frame.toLocal(wi).normalized();
-
-        const float cosTheta = Frame::absCosTheta(localWi);
+        // the side that emits is decided by the geometry, regardless of interpolated normals or normal maps
+        const Vector localWi = Frame(sample.geometryNormal).toLocal(wi).normalized();
         const Color emission = m_instance->emission()->evaluate(sample.uv, -localWi).value;
 
-        return {wi, (emission * cosTheta) / (sqr(length) * sample.pdf), length};
+        return {wi, emission / sample.pdf, length, sample.pdf};
+    }
+
+    float pdf(const Point &origin, const Intersection &its) const override {
+        return m_instance->pdfSolidAngle(origin, its);
     }
 
     bool canBeIntersected() const override { return m_instance->isVisible(); }
 
+    float power(const Bounds &sceneBounds, Sampler &rng) const override {
+        // integrate the emitted radiance over the surface, assuming a lambertian emitter
+        constexpr int NumSamples = 64;
+        float sum = 0;
+        for (int i = 0; i < NumSamples; i++) {
+            const AreaSample sample = m_instance->sampleArea(rng);
+            if (sample.pdf == 0.f) continue;
+            const Color emission = m_instance->emission()->evaluate(sample.uv, Vector(0, 0, 1)).value;
+            sum += emission.luminance() / sample.pdf;
+        }
+        return Pi * sum / NumSamples;
+    }
+
+    Bounds getBoundingBox() const override { return m_instance->getBoundingBox(); }
+
     std::string toString() const override {
         return tfm::format("AreaLight[]");
     }
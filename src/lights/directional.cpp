@@ -14,11 +14,18 @@ public:
         dls.wi = m_direction.normalized();
         dls.distance = Infinity;
         dls.weight = m_intensity;
+        dls.pdf = Infinity;
         return dls;
     }
 
     bool canBeIntersected() const override { return false; }
 
+    float power(const Bounds &sceneBounds, Sampler &rng) const override {
+        // the light that falls onto a disk that covers the scene
+        const float radius = sceneBounds.diagonal().length() / 2;
+        return m_intensity.luminance() * Pi * sqr(radius);
+    }
+
     std::string toString() const override {
         return tfm::format("DirectionalLight[]");
     }
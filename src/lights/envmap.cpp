@@ -9,10 +9,65 @@ class EnvironmentMap final : public BackgroundLight {
     /// @brief An optional transform from local-to-world space
     ref<Transform> m_transform;
 
+    /// @brief Whether directions are sampled proportionally to the emitted radiance (instead of uniformly)
+    bool m_importanceSampling;
+    /// @brief The distribution of radiance over the texture coordinates, used for importance sampling
+    Distribution2D m_distribution;
+
+    /// @brief Converts texture coordinates to a direction in local space, the inverse of @ref directionToSphereUV
+    static Vector sphereUVToDirection(const Point2 &uv, float &sinTheta) {
+        const float theta = uv.y() * Pi;
+        const float phi   = (0.5f - uv.x()) * 2 * Pi;
+        sinTheta          = std::sin(theta);
+        return { sinTheta * std::cos(phi), std::cos(theta), sinTheta * std::sin(phi) };
+    }
+
+    /**
+     * @brief Tabulates the luminance of the texture, weighted by the area each texel covers on the sphere.
+     * Each cell is supersampled so that small bright features (like the sun) are not missed.
+     */
+    void buildDistribution(int width) {
+        constexpr int Supersampling = 2;
+        const int height = std::max(width / 2, 1);
+
+        std::vector<float> function(size_t(width) * height);
+        parallel_for(0, height, [&](int y) {
+            for (int x = 0; x < width; x++) {
+                float sum = 0;
+                for (int sy = 0; sy < Supersampling; sy++) {
+                    for (int sx = 0; sx < Supersampling; sx++) {
+                        const Point2 uv = {
+                            (x + (sx + 0.5f) / Supersampling) / width,
+                            (y + (sy + 0.5f) / Supersampling) / height,
+                        };
+                        sum += m_texture->evaluate(uv).luminance() * std::sin(uv.y() * Pi);
+                    }
+                }
+                function[size_t(y) * width + x] = sum / sqr(Supersampling);
+            }
+        });
+
+        // the tabulated values are only an approximation of the texture, hence every direction keeps a small
+        // probability so that no emission can be missed
+        double total = 0;
+        for (float value : function) total += value;
+        const float minValue = float(1e-3 * total / function.size());
+        for (float &value : function) value = std::max(value, minValue);
+
+        m_distribution = Distribution2D(function, width, height);
+    }
+
 public:
+    using BackgroundLight::pdf;
+
     EnvironmentMap(const Properties &properties) {
         m_texture   = properties.getChild<Texture>();
         m_transform = properties.getOptionalChild<Transform>();
+
+        m_importanceSampling = properties.get<bool>("importanceSampling", true);
+        if (m_importanceSampling) {
+            buildDistribution(properties.get<int>("samplingResolution", 1024));
+        }
     }
 
     BackgroundLightEval evaluate(const Vector &direction) const override {
@@ -31,20 +86,60 @@ public:
 
     DirectLightSample sampleDirect(const Point &origin,
                                    Sampler &rng) const override {
-        Vector direction = squareToUniformSphere(rng.next2D());
-        auto E           = evaluate(direction);
+        if (!m_importanceSampling) {
+            Vector direction = squareToUniformSphere(rng.next2D());
+            auto E           = evaluate(direction);
+            return {
+                .wi     = direction,
+                .weight = E.value / Inv4Pi,
+                .distance = Infinity,
+                .pdf    = Inv4Pi,
+            };
+        }
 
-        // implement better importance sampling here, if you ever need it
-        // (useful for environment maps with bright tiny light sources, like the
-        // sun for example)
+        float uvPdf, sinTheta;
+        const Point2 uv = m_distribution.sample(rng.next2D(), uvPdf);
+        Vector direction = sphereUVToDirection(uv, sinTheta);
+        if (uvPdf == 0 || sinTheta == 0) return DirectLightSample::invalid();
 
+        if (m_transform) {
+            direction = m_transform->apply(direction).normalized();
+        }
+
+        // account for the change of variables from texture coordinates to solid angle
+        const float pdf = uvPdf / (2 * sqr(Pi) * sinTheta);
         return {
             .wi     = direction,
-            .weight = E.value / Inv4Pi,
+            .weight = evaluate(direction).value / pdf,
             .distance = Infinity,
+            .pdf    = pdf,
         };
     }
 
+    float pdf(const Vector &direction) const override {
+        if (!m_importanceSampling) return Inv4Pi;
+
+        Vector localDir = direction;
+        if (m_transform) {
+            localDir = m_transform->inverse(direction).normalized();
+        }
+
+        const float sinTheta = safe_sqrt(1 - sqr(localDir.y()));
+        if (sinTheta == 0) return 0;
+        return m_distribution.pdf(directionToSphereUV(localDir)) / (2 * sqr(Pi) * sinTheta);
+    }
+
+    float power(const Bounds &sceneBounds, Sampler &rng) const override {
+        // the average radiance falling onto a disk that covers the scene
+        constexpr int NumSamples = 1024;
+        float sum = 0;
+        for (int i = 0; i < NumSamples; i++)
+            sum += evaluate(squareToUniformSphere(rng.next2D())).value.luminance();
+
+        const float radius = sceneBounds.diagonal().length() / 2;
+        return Pi * sum / NumSamples * Pi * sqr(radius);
+    }
+
     std::string toString() const override {
         return tfm::format("EnvironmentMap[\n"
                            "  texture = %s,\n"
@@ -15,11 +15,19 @@ public:
     DirectLightSample sampleDirect(const Point &origin,
                                    Sampler &rng) const override {
         auto [length, dir] = Vector(m_position - origin).lengthAndNormalized();
-        return { dir, m_color / (sqr(length) * Pi * 4.f), length };
+        return { dir, m_color / (sqr(length) * Pi * 4.f), length, Infinity };
     }
 
     bool canBeIntersected() const override { return false; }
 
+    float power(const Bounds &sceneBounds, Sampler &rng) const override {
+        return m_color.luminance();
+    }
+
+    Bounds getBoundingBox() const override {
+        return Bounds(m_position, m_position);
+    }
+
     std::string toString() const override {
         return tfm::format("PointLight[\n"
                            "]");
@@ -34,11 +34,22 @@ public:
 
         sample.wi = -dir;
         sample.distance = length;
+        sample.pdf = Infinity;
         return sample;
     }
 
     bool canBeIntersected() const override { return false; }
 
+    float power(const Bounds &sceneBounds, Sampler &rng) const override {
+        // intensity times the solid angle of the cone, counting half of the falloff region
+        const float cosCutoff = std::cos(std::min(m_angle + m_falloff / 2, Pi));
+        return m_intensity.luminance() * 2 * Pi * (1 - cosCutoff);
+    }
+
+    Bounds getBoundingBox() const override {
+        return Bounds(m_position, m_position);
+    }
+
     std::string toString() const override {
         return tfm::format("SpotLight[\n"
                            "]");
@@ -38,14 +38,7 @@ namespace lightwave {
 
             blendAdd(*m_output, result, m_amount);
 
-            logger(EDebug, "Saving bloomed image");
-            
-            m_output->save();
-
-            logger(EDebug, "Bloomed image saved sucessfully");
-
-            Streaming stream { *m_output };
-            stream.update();
+            publishOutput();
         }
 
         std::string toString() const override {
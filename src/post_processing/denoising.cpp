@@ -56,16 +56,11 @@ namespace lightwave {
             filter.commit();    
             filter.execute();
             
-            logger(EDebug, "Saving denoised image");
-
-            m_output->save();
-
-            logger(EDebug, "Denoised image saved sucessfully");
-
-            Streaming stream { *m_output };
-            stream.update();
+            publishOutput();
         }
 
+        std::vector<ref<Image>> inputs() const override { return { m_input, m_normals, m_albedo }; }
+
         std::string toString() const override {
             return tfm::format("Denoising post-process");
         }
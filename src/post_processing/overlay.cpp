@@ -32,13 +32,11 @@ namespace lightwave {
                 blendMult(*m_output, m_overlay, m_amount);
             }
 
-            logger(EDebug, "Saving Overlayed image");
-            
-            m_output->save();
-
-            logger(EDebug, "Overlayed image saved sucessfully");
+            publishOutput();
         }
 
+        std::vector<ref<Image>> inputs() const override { return { m_input, m_overlay }; }
+
         std::string toString() const override {
             return tfm::format("Overlay post-process");
         }
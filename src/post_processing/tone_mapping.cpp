@@ -23,15 +23,7 @@ namespace lightwave {
         
             m_output->replace(m_useLogScale ? extendedLogScale() : reinhardJodie());
 
-            // Save image after tone mapping
-            logger(EDebug, "Saving toned mapped image");
-
-            m_output->save();
-
-            logger(EDebug, "Tone mapped image saved sucessfully");
-            
-            Streaming stream { *m_output };
-            stream.update();
+            publishOutput();
         }
 
         std::string toString() const override {
@@ -58,14 +50,19 @@ namespace lightwave {
                 maxB = std::max(maxB, color.b());
             }
 
-            for (auto pixel : m_input->bounds()) {
-                const Color current = m_input->get(pixel);
-                toned.push_back({
-                    applyExtendedLogScale(current.r(), maxR),
-                    applyExtendedLogScale(current.g(), maxG),
-                    applyExtendedLogScale(current.b(), maxB),
-                });
-            }
+            const int count = m_input->resolution().x() * m_input->resolution().y();
+            toned.resize(count);
+
+            const Color *input = m_input->data();
+            for_each_parallel(ChunkedRange(count, 4096), [&](Range chunk) {
+                for (int i : chunk) {
+                    toned[i] = {
+                        applyExtendedLogScale(input[i].r(), maxR),
+                        applyExtendedLogScale(input[i].g(), maxG),
+                        applyExtendedLogScale(input[i].b(), maxB),
+                    };
+                }
+            });
             return toned;
         }
 
@@ -80,10 +77,14 @@ namespace lightwave {
         }
 
         std::vector<Color> reinhardJodie() {
-            std::vector<Color> toned;
+            const int count = m_input->resolution().x() * m_input->resolution().y();
+            std::vector<Color> toned(count);
 
-            for (auto pixel : m_input->bounds()) 
-                toned.push_back(applyReinhardJodie(m_input->get(pixel)));
+            const Color *input = m_input->data();
+            for_each_parallel(ChunkedRange(count, 4096), [&](Range chunk) {
+                for (int i : chunk)
+                    toned[i] = applyReinhardJodie(input[i]);
+            });
             
             return toned;
         }
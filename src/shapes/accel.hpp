@@ -3,8 +3,16 @@
 #include <lightwave/core.hpp>
 #include <lightwave/math.hpp>
 #include <lightwave/shape.hpp>
+#include <lightwave/iterators.hpp>
+#include <lightwave/parallel.hpp>
 
+#include <bit>
 #include <numeric>
+#include <unordered_map>
+
+#ifdef LW_CPU_X86
+#include <immintrin.h>
+#endif
 
 namespace lightwave {
 
@@ -76,8 +84,136 @@ class AccelerationStructure : public Shape {
         int count = 0;
     };
 
-    /// @brief A list of all BVH nodes.
+    /// @brief A reference to a child used by the spatial split builder, whose
+    /// bounding box may have been clipped by earlier splits.
+    struct Reference {
+        Bounds bounds;
+        int primitive;
+    };
+
+    /// @brief A candidate split of a node considered by the spatial split
+    /// builder.
+    struct Split {
+        /// @brief The SAH cost of the split, or Infinity if no split exists.
+        float cost = Infinity;
+        int axis   = 0;
+        /// @brief Whether references may straddle the split plane and are
+        /// clipped against it, rather than being sorted by their centroid.
+        bool spatial = false;
+        /// @brief For spatial splits: the position of the split plane.
+        float position = 0;
+        /// @brief For object splits: the binning that was used, with all
+        /// references in bins up to (and including) @c bin going left.
+        float binMin = 0, binScale = 0;
+        int bin      = 0;
+        /// @brief The bounding boxes of the two children.
+        Bounds leftBounds, rightBounds;
+    };
+
+    /// @brief A subtree whose spatial split build has been deferred to a task.
+    struct SpatialSplitTask {
+        NodeIndex node;
+        int depth;
+        std::vector<Reference> refs;
+    };
+
+    /**
+     * @brief A node of the flattened BVH used for traversal, padded to 32
+     * bytes so that two nodes share a cache line.
+     * Nodes are stored in depth-first order, i.e., the left child of an
+     * internal node always directly follows its parent, and only the index of
+     * the right child needs to be stored.
+     */
+    struct alignas(32) FlatNode {
+        /// @brief The axis aligned bounding box of this node.
+        Bounds aabb;
+        /**
+         * @brief Either the index of the right child node in m_flatNodes (for
+         * internal nodes), or the first primitive in m_primitiveIndices (for
+         * leaf nodes).
+         */
+        NodeIndex offset;
+        /// @brief The number of primitives in a leaf node, or 0 to indicate
+        /// that this node is not a leaf node.
+        NodeIndex primitiveCount;
+
+        /// @brief Whether this BVH node is a leaf node.
+        bool isLeaf() const { return primitiveCount != 0; }
+    };
+    static_assert(sizeof(FlatNode) == 32, "BVH nodes should be 32 bytes");
+
+    /**
+     * @brief A node of a wide BVH, which stores the bounding boxes of all of
+     * its children in SoA layout so that they can be tested at once using
+     * SIMD instructions.
+     * Leaf children are stored inline, so that only internal children require
+     * a node of their own. Unused slots hold empty bounding boxes, which are
+     * never hit.
+     */
+    template <int Width> struct alignas(64) WideNode {
+        /// @brief The bounding boxes of the children, indexed by
+        /// [min/max][axis][child].
+        float bounds[2][3][Width];
+        /**
+         * @brief Either the index of the child node in the list of wide nodes
+         * (for internal children), or the first primitive in
+         * m_primitiveIndices (for leaf children).
+         */
+        NodeIndex offset[Width];
+        /// @brief The number of primitives of leaf children, or 0 for internal
+        /// children and unused slots.
+        NodeIndex primitiveCount[Width];
+    };
+
+    /// @brief Per-ray quantities that are computed once before traversal, so
+    /// that slab tests only need multiplications.
+    struct TraversalRay {
+        Point origin;
+        /// @brief The componentwise reciprocal of the ray direction.
+        Vector invDirection;
+        /// @brief Whether the ray direction is negative along each axis, which
+        /// determines whether the min or max slab is hit first.
+        bool isNegative[3];
+
+        TraversalRay(const Ray &ray) : origin(ray.origin) {
+            for (int dim = 0; dim < 3; dim++) {
+                invDirection[dim] = 1 / ray.direction[dim];
+                isNegative[dim]   = invDirection[dim] < 0;
+            }
+        }
+    };
+
+    /// @brief The maximum number of nodes pending on the traversal stack.
+    static constexpr int TraversalStackSize = 64;
+    /// @brief The maximum depth of the BVH, chosen such that traversal can
+    /// never overflow its stack.
+    static constexpr int MaxDepth = TraversalStackSize - 1;
+
+    /// @brief A list of all BVH nodes, only used while building.
     std::vector<Node> m_nodes;
+    /// @brief A list of all BVH nodes in depth-first order, used for traversal
+    /// of binary BVHs.
+    std::vector<FlatNode> m_flatNodes;
+    /// @brief The nodes of the 4-wide BVH, with the root node first.
+    std::vector<WideNode<4>> m_wideNodes4;
+    /// @brief The nodes of the 8-wide BVH, with the root node first.
+    std::vector<WideNode<8>> m_wideNodes8;
+    /// @brief The number of children per node used for traversal (2, 4 or 8).
+    int m_width;
+    /// @brief The bounding box of all primitives.
+    Bounds m_aabb;
+    /// @brief Whether to build the BVH with spatial splits, which may
+    /// reference children from multiple leaves.
+    bool m_spatialSplits;
+    /**
+     * @brief Spatial splits are only considered for nodes whose object split
+     * children overlap by more than this fraction of the root surface area.
+     * Lower values allow more splits, and hence more duplicated references.
+     */
+    float m_spatialSplitAlpha;
+    /// @brief Whether to also build the BVH with object splits only, to
+    /// report how much spatial splits lower the SAH cost.
+    bool m_compareSpatialSplits;
     /**
      * @brief Mapping from internal @c NodeIndex to @c primitiveIndex as used by
      * all interface methods. For efficient storage, we assume that children of
@@ -90,76 +226,108 @@ class AccelerationStructure : public Shape {
     std::vector<int> m_primitiveIndices;
 
     /// @brief Returns the root BVH node.
-    const Node &rootNode() const {
-        // by convention, this is always the first element of m_nodes
-        return m_nodes.front();
+    const FlatNode &rootNode() const {
+        // by convention, this is always the first element of m_flatNodes
+        return m_flatNodes.front();
     }
 
     /**
-     * @brief Intersects a BVH node, recursing into children (for internal
-     * nodes), or intersecting all primitives (for leaf nodes).
+     * @brief Traverses the BVH iteratively, visiting children in the order
+     * they are intersected in.
+     * @param tMax The maximum distance of interest, which may shrink while
+     * leaves are visited.
+     * @param nodeCounter Incremented for every BVH node that is visited.
+     * @param visitLeaf Called with the first index into m_primitiveIndices
+     * and the number of primitives of every leaf that is entered before
+     * @c tMax , returning whether traversal can stop right away.
+     * @return Whether traversal was stopped by @c visitLeaf .
      */
-    bool intersectNode(const Node &node, const Ray &ray, Intersection &its,
-                       Sampler &rng) const {
-        // update the statistic tracking how many BVH nodes have been tested for
-        // intersection
-        its.stats.bvhCounter++;
+    template <typename VisitLeaf>
+    bool traverseNodes(const Ray &ray, const float &tMax, int &nodeCounter,
+                       VisitLeaf &&visitLeaf) const {
+        const TraversalRay traversalRay(ray);
 
-        bool wasIntersected = false;
-        if (node.isLeaf()) {
-            for (NodeIndex i = 0; i < node.primitiveCount; i++) {
-                // update the statistic tracking how many children have been
-                // tested for intersection
-                its.stats.primCounter++;
-                // test the child for intersection
-                wasIntersected |= intersect(
-                    m_primitiveIndices[node.leftFirst + i], ray, its, rng);
-            }
-        } else { // internal node
-            // test which bounding box is intersected first by the ray.
-            // this allows us to traverse the children in the order they are
-            // intersected in, which can help prune a lot of unnecessary
-            // intersection tests.
-            const auto leftT =
-                intersectAABB(m_nodes[node.leftChildIndex()].aabb, ray);
-            const auto rightT =
-                intersectAABB(m_nodes[node.rightChildIndex()].aabb, ray);
-            if (leftT < rightT) { // left child is hit first; test left child
-                                  // first, then right child
-                if (leftT < its.t)
-                    wasIntersected |= intersectNode(
-                        m_nodes[node.leftChildIndex()], ray, its, rng);
-                if (rightT < its.t)
-                    wasIntersected |= intersectNode(
-                        m_nodes[node.rightChildIndex()], ray, its, rng);
-            } else { // right child is hit first; test right child first, then
-                     // left child
-                if (rightT < its.t)
-                    wasIntersected |= intersectNode(
-                        m_nodes[node.rightChildIndex()], ray, its, rng);
-                if (leftT < its.t)
-                    wasIntersected |= intersectNode(
-                        m_nodes[node.leftChildIndex()], ray, its, rng);
+        /// @brief A node that still needs to be visited, along with the
+        /// distance at which its bounding box is entered.
+        struct StackEntry {
+            NodeIndex node;
+            float t;
+        };
+        StackEntry stack[TraversalStackSize];
+        int stackSize = 0;
+
+        // test root bounding box for potential hit
+        if (!(intersectAABB(rootNode().aabb, traversalRay) < tMax))
+            return false;
+
+        // keep the buffer in a register; the compiler cannot prove that the
+        // virtual intersect calls made by visitLeaf leave it untouched
+        const FlatNode *nodes = m_flatNodes.data();
+
+        NodeIndex current = 0;
+        while (true) {
+            nodeCounter++;
+
+            const FlatNode &node = nodes[current];
+            if (node.isLeaf()) {
+                if (visitLeaf(node.offset, node.primitiveCount))
+                    return true;
+            } else {
+                // test which bounding box is intersected first by the ray.
+                // this allows us to traverse the children in the order they
+                // are intersected in, which can help prune a lot of
+                // unnecessary intersection tests.
+                StackEntry nearChild = { current + 1, 0 };
+                StackEntry farChild  = { node.offset, 0 };
+                nearChild.t =
+                    intersectAABB(nodes[nearChild.node].aabb, traversalRay);
+                farChild.t =
+                    intersectAABB(nodes[farChild.node].aabb, traversalRay);
+                if (!(nearChild.t < farChild.t))
+                    std::swap(nearChild, farChild);
+
+                // if the nearer child is missed, so is the farther one
+                if (nearChild.t < tMax) {
+                    // descend into the nearer child right away, and revisit
+                    // the farther one once the nearer subtree is done
+                    if (farChild.t < tMax)
+                        stack[stackSize++] = farChild;
+                    current = nearChild.node;
+                    continue;
+                }
             }
+
+            // pop the next pending node, skipping those whose bounding box
+            // lies behind an intersection that has been found since they were
+            // pushed
+            while (stackSize > 0 && !(stack[stackSize - 1].t < tMax))
+                stackSize--;
+            if (stackSize == 0)
+                break;
+            current = stack[--stackSize].node;
         }
-        return wasIntersected;
+        return false;
     }
 
     /// @brief Performs a slab test to intersect a bounding box with a ray,
     /// returning Infinity in case the ray misses.
-    float intersectAABB(const Bounds &bounds, const Ray &ray) const {
-        // but this only saves us ~1%, so let's not do it. intersect all axes at
-        // once with the minimum slabs of the bounding box
-        const auto t1 = (bounds.min() - ray.origin) / ray.direction;
-        // intersect all axes at once with the maximum slabs of the bounding box
-        const auto t2 = (bounds.max() - ray.origin) / ray.direction;
-
-        // the elementwiseMin picks the near slab for each axis, of which we
-        // then take the maximum
-        const auto tNear = elementwiseMin(t1, t2).maxComponent();
-        // the elementwiseMax picks the far slab for each axis, of which we then
-        // take the minimum
-        const auto tFar = elementwiseMax(t1, t2).minComponent();
+    float intersectAABB(const Bounds &bounds, const TraversalRay &ray) const {
+        // the sign of the direction tells us which slab of each axis is
+        // entered first, which saves us from sorting the slab distances
+        const auto slabDistance = [&](int dim, bool far) {
+            const bool useMax = ray.isNegative[dim] != far;
+            const float slab  = useMax ? bounds.max()[dim] : bounds.min()[dim];
+            return (slab - ray.origin[dim]) * ray.invDirection[dim];
+        };
+
+        // start from the first axis rather than +-Infinity, so that rays with
+        // invalid (NaN) directions keep propagating NaN and miss every box
+        float tNear = slabDistance(0, false);
+        float tFar  = slabDistance(0, true);
+        for (int dim = 1; dim < 3; dim++) {
+            tNear = std::max(tNear, slabDistance(dim, false));
+            tFar  = std::min(tFar, slabDistance(dim, true));
+        }
 
         if (tFar < tNear)
             return Infinity; // the ray does not intersect the bounding box
@@ -170,14 +338,237 @@ class AccelerationStructure : public Shape {
                       // (may also be negative!)
     }
 
+    /**
+     * @brief Performs slab tests for four consecutive children of a wide node
+     * at once, writing the distances at which they are entered to @c t .
+     * @return A bitmask of the children that are entered before @c tMax .
+     */
+    template <int Width>
+    static int intersectAABB4(const WideNode<Width> &node, int first,
+                              const TraversalRay &ray, float tMax, float *t) {
+#ifdef LW_CPU_X86
+        const auto slabDistance = [&](int dim, bool far) {
+            const bool useMax = ray.isNegative[dim] != far;
+            const __m128 slab = _mm_load_ps(&node.bounds[useMax][dim][first]);
+            return _mm_mul_ps(_mm_sub_ps(slab, _mm_set1_ps(ray.origin[dim])),
+                              _mm_set1_ps(ray.invDirection[dim]));
+        };
+
+        // SSE min/max return their second operand if either is NaN, so rays
+        // with invalid directions keep missing like in the scalar test
+        __m128 tNear = slabDistance(0, false);
+        __m128 tFar  = slabDistance(0, true);
+        for (int dim = 1; dim < 3; dim++) {
+            tNear = _mm_max_ps(slabDistance(dim, false), tNear);
+            tFar  = _mm_min_ps(slabDistance(dim, true), tFar);
+        }
+
+        const __m128 hit = _mm_and_ps(
+            _mm_and_ps(_mm_cmple_ps(tNear, tFar),
+                       _mm_cmpge_ps(tFar, _mm_set1_ps(Epsilon))),
+            _mm_cmplt_ps(tNear, _mm_set1_ps(tMax)));
+        _mm_storeu_ps(t, tNear);
+        return _mm_movemask_ps(hit);
+#else
+        int mask = 0;
+        for (int lane = 0; lane < 4; lane++) {
+            const int child = first + lane;
+            const auto slabDistance = [&](int dim, bool far) {
+                const bool useMax = ray.isNegative[dim] != far;
+                return (node.bounds[useMax][dim][child] - ray.origin[dim]) *
+                       ray.invDirection[dim];
+            };
+
+            float tNear = slabDistance(0, false);
+            float tFar  = slabDistance(0, true);
+            for (int dim = 1; dim < 3; dim++) {
+                tNear = std::max(tNear, slabDistance(dim, false));
+                tFar  = std::min(tFar, slabDistance(dim, true));
+            }
+
+            t[lane] = tNear;
+            if (tNear <= tFar && tFar >= Epsilon && tNear < tMax)
+                mask |= 1 << lane;
+        }
+        return mask;
+#endif
+    }
+
+#ifdef __AVX__
+    /// @brief Performs slab tests for all children of an 8-wide node at once.
+    /// @see intersectAABB4
+    static int intersectAABB8(const WideNode<8> &node, const TraversalRay &ray,
+                              float tMax, float *t) {
+        const auto slabDistance = [&](int dim, bool far) {
+            const bool useMax  = ray.isNegative[dim] != far;
+            const __m256 slab = _mm256_load_ps(node.bounds[useMax][dim]);
+            return _mm256_mul_ps(
+                _mm256_sub_ps(slab, _mm256_set1_ps(ray.origin[dim])),
+                _mm256_set1_ps(ray.invDirection[dim]));
+        };
+
+        __m256 tNear = slabDistance(0, false);
+        __m256 tFar  = slabDistance(0, true);
+        for (int dim = 1; dim < 3; dim++) {
+            tNear = _mm256_max_ps(slabDistance(dim, false), tNear);
+            tFar  = _mm256_min_ps(slabDistance(dim, true), tFar);
+        }
+
+        const __m256 hit = _mm256_and_ps(
+            _mm256_and_ps(
+                _mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ),
+                _mm256_cmp_ps(tFar, _mm256_set1_ps(Epsilon), _CMP_GE_OQ)),
+            _mm256_cmp_ps(tNear, _mm256_set1_ps(tMax), _CMP_LT_OQ));
+        _mm256_storeu_ps(t, tNear);
+        return _mm256_movemask_ps(hit);
+    }
+#endif
+
+    /// @brief Intersects the ray with all children of a wide node, returning a
+    /// bitmask of the children that are entered before @c tMax .
+    template <int Width>
+    static int intersectChildren(const WideNode<Width> &node,
+                                 const TraversalRay &ray, float tMax,
+                                 float *t) {
+#ifdef __AVX__
+        if constexpr (Width == 8)
+            return intersectAABB8(node, ray, tMax, t);
+#endif
+        int mask = 0;
+        for (int first = 0; first < Width; first += 4)
+            mask |= intersectAABB4(node, first, ray, tMax, t + first) << first;
+        return mask;
+    }
+
+    /**
+     * @brief Traverses a wide BVH iteratively. All children of a node are
+     * tested at once, and the ones that are hit are pushed so that the nearest
+     * child is visited first.
+     * @see traverseNodes
+     */
+    template <int Width, typename VisitLeaf>
+    bool traverseWideNodes(const std::vector<WideNode<Width>> &wideNodes,
+                           const Ray &ray, const float &tMax, int &nodeCounter,
+                           VisitLeaf &&visitLeaf) const {
+        const TraversalRay traversalRay(ray);
+
+        /// @brief A child that still needs to be visited, along with the
+        /// distance at which its bounding box is entered.
+        struct StackEntry {
+            NodeIndex offset;
+            NodeIndex primitiveCount;
+            float t;
+        };
+        // every node visit replaces one entry by at most Width entries
+        StackEntry stack[MaxDepth * (Width - 1) + 1];
+        int stackSize = 0;
+        stack[stackSize++] = { 0, 0, -Infinity };
+
+        const WideNode<Width> *nodes = wideNodes.data();
+
+        while (stackSize > 0) {
+            // skip entries whose bounding box lies behind an intersection that
+            // has been found since they were pushed
+            const StackEntry entry = stack[--stackSize];
+            if (!(entry.t < tMax))
+                continue;
+
+            if (entry.primitiveCount > 0) {
+                if (visitLeaf(entry.offset, entry.primitiveCount))
+                    return true;
+                continue;
+            }
+
+            nodeCounter++;
+            const WideNode<Width> &node = nodes[entry.offset];
+            alignas(32) float t[Width];
+            int hitMask = intersectChildren(node, traversalRay, tMax, t);
+
+            // insertion sort the children that were hit by descending
+            // distance, so that the nearest one ends up on top of the stack
+            const int firstPushed = stackSize;
+            while (hitMask) {
+                const int child = std::countr_zero(unsigned(hitMask));
+                hitMask &= hitMask - 1;
+
+                const StackEntry pending = { node.offset[child],
+                                             node.primitiveCount[child],
+                                             t[child] };
+                int slot = stackSize++;
+                while (slot > firstPushed && stack[slot - 1].t < pending.t) {
+                    stack[slot] = stack[slot - 1];
+                    slot--;
+                }
+                stack[slot] = pending;
+            }
+        }
+        return false;
+    }
+
+    /// @brief Traverses the BVH in the layout selected by m_width.
+    /// @see traverseNodes
+    template <typename VisitLeaf>
+    bool traverse(const Ray &ray, const float &tMax, int &nodeCounter,
+                  VisitLeaf &&visitLeaf) const {
+        if (m_width == 4)
+            return traverseWideNodes(m_wideNodes4, ray, tMax, nodeCounter,
+                                     visitLeaf);
+        if (m_width == 8)
+            return traverseWideNodes(m_wideNodes8, ray, tMax, nodeCounter,
+                                     visitLeaf);
+        return traverseNodes(ray, tMax, nodeCounter, visitLeaf);
+    }
+
+    /// @brief Nodes with at least this many primitives are binned using all
+    /// available threads.
+    static constexpr NodeIndex ParallelBinningThreshold = 1 << 16;
+    /// @brief Nodes with fewer primitives than this are built as independent
+    /// tasks once the top levels of the BVH have been split.
+    static constexpr NodeIndex SubtreeTaskThreshold = 1 << 14;
+    /// @brief The number of primitives each thread processes at once during
+    /// parallel binning.
+    static constexpr int BinningChunkSize = 1 << 12;
+
+    /**
+     * @brief Folds @c accumulate over all primitives of a node, starting from
+     * @c identity . Large nodes are split into chunks that are folded
+     * concurrently and then combined using @c merge .
+     * @note Since @c merge is only used for min/max and integer sums, the
+     * result does not depend on the order in which chunks finish.
+     */
+    template <typename Accumulator, typename Accumulate, typename Merge>
+    Accumulator reducePrimitives(const Node &node, const Accumulator &identity,
+                                 Accumulate accumulate, Merge merge) const {
+        Accumulator result = identity;
+        if (node.primitiveCount < ParallelBinningThreshold) {
+            for (NodeIndex i = 0; i < node.primitiveCount; i++)
+                accumulate(result, m_primitiveIndices[node.leftFirst + i]);
+            return result;
+        }
+
+        std::mutex mutex;
+        for_each_parallel(
+            ChunkedRange(node.firstPrimitiveIndex(),
+                         node.lastPrimitiveIndex() + 1, BinningChunkSize),
+            [&](Range chunk) {
+                Accumulator local = identity;
+                for (int i : chunk)
+                    accumulate(local, m_primitiveIndices[i]);
+
+                std::lock_guard lock(mutex);
+                merge(result, local);
+            });
+        return result;
+    }
+
     /// @brief Computes the axis aligned bounding box for a leaf BVH node
     void computeAABB(Node &node) {
-        node.aabb = Bounds::empty();
-        for (NodeIndex i = 0; i < node.primitiveCount; i++) {
-            const Bounds childAABB =
-                getBoundingBox(m_primitiveIndices[node.leftFirst + i]);
-            node.aabb.extend(childAABB);
-        }
+        node.aabb = reducePrimitives(
+            node, Bounds::empty(),
+            [&](Bounds &aabb, int primitive) {
+                aabb.extend(getBoundingBox(primitive));
+            },
+            [](Bounds &aabb, const Bounds &other) { aabb.extend(other); });
     }
 
     /// @brief Computes the surface area of a bounding box.
@@ -188,28 +579,36 @@ class AccelerationStructure : public Shape {
     }
 
     std::tuple<float, float> calculateMinAndMaxBounds(Node &node, int splitAxis) const {
-        float boundsMin = Infinity;
-        float boundsMax = -Infinity;
-
-        for (int i = 0; i < node.primitiveCount; i++) {
-            const Point centroid = getCentroid(m_primitiveIndices[node.leftFirst + i]);
-            boundsMin = std::min(boundsMin, centroid[splitAxis]);
-            boundsMax = std::max(boundsMax, centroid[splitAxis]);
-        }
+        const auto [boundsMin, boundsMax] = reducePrimitives(
+            node, std::pair<float, float>(Infinity, -Infinity),
+            [&](std::pair<float, float> &range, int primitive) {
+                const Point centroid = getCentroid(primitive);
+                range.first  = std::min(range.first, centroid[splitAxis]);
+                range.second = std::max(range.second, centroid[splitAxis]);
+            },
+            [](std::pair<float, float> &range, const std::pair<float, float> &other) {
+                range.first  = std::min(range.first, other.first);
+                range.second = std::max(range.second, other.second);
+            });
         return {boundsMin, boundsMax};
     }
 
     std::vector<Bin> populateBins(Node &node, int splitAxis, float boundsMin, float scale, int BINS) const {
-        std::vector<Bin> bins(BINS);
-        for (int i = 0; i < node.primitiveCount; i++) {
-            const int primitiveIndex = node.leftFirst + i;
-            const Point centroid = getCentroid(m_primitiveIndices[primitiveIndex]);
-            const Bounds bounds = getBoundingBox(m_primitiveIndices[primitiveIndex]);
-            const int binIndex = std::min((int)((centroid[splitAxis] - boundsMin) * scale), BINS - 1);
-            bins[binIndex].count++;
-            bins[binIndex].bounds.extend(bounds);
-        }
-        return bins;
+        return reducePrimitives(
+            node, std::vector<Bin>(BINS),
+            [&](std::vector<Bin> &bins, int primitive) {
+                const Point centroid = getCentroid(primitive);
+                const Bounds bounds = getBoundingBox(primitive);
+                const int binIndex = std::min((int)((centroid[splitAxis] - boundsMin) * scale), BINS - 1);
+                bins[binIndex].count++;
+                bins[binIndex].bounds.extend(bounds);
+            },
+            [](std::vector<Bin> &bins, const std::vector<Bin> &other) {
+                for (size_t i = 0; i < bins.size(); i++) {
+                    bins[i].count += other[i].count;
+                    bins[i].bounds.extend(other[i].bounds);
+                }
+            });
     }
 
     std::tuple<float, float> findBestSplitPlane(Node &node, int splitAxis) {
@@ -285,10 +684,27 @@ class AccelerationStructure : public Shape {
         return firstRightIndex;
     }
 
-    /// @brief Attempts to subdivide a given BVH node.
-    void subdivide(Node &parent) {
+    /**
+     * @brief Attempts to subdivide a given BVH node.
+     * @param nodes The list of nodes the parent lives in, which children are
+     * appended to.
+     * @param depth The depth of the parent node, which must not exceed @ref
+     * MaxDepth so that traversal never overflows its stack.
+     * @param deferred If given, children with fewer than @ref
+     * SubtreeTaskThreshold primitives are not subdivided any further, but
+     * recorded in this list so that their subtrees can be built concurrently.
+     */
+    void subdivide(std::vector<Node> &nodes, NodeIndex parentIndex, int depth,
+                   std::vector<std::pair<NodeIndex, int>> *deferred = nullptr) {
+        Node &parent = nodes[parentIndex];
+
         // only subdivide if enough children are available.
-        if (parent.primitiveCount <= 2) {
+        if (parent.primitiveCount <= 2 || depth >= MaxDepth) {
+            return;
+        }
+
+        if (deferred && parent.primitiveCount < SubtreeTaskThreshold) {
+            deferred->emplace_back(parentIndex, depth);
             return;
         }
 
@@ -325,30 +741,623 @@ class AccelerationStructure : public Shape {
             return;
         }
 
-        // the two children will always be contiguous in our m_nodes list
-        const auto leftChildIndex  = (NodeIndex) (m_nodes.size() + 0);
-        const auto rightChildIndex = (NodeIndex) (m_nodes.size() + 1);
+        // the two children will always be contiguous in our nodes list
+        const auto leftChildIndex  = (NodeIndex) (nodes.size() + 0);
+        const auto rightChildIndex = (NodeIndex) (nodes.size() + 1);
         parent.primitiveCount = 0; // mark the parent node as internal node
         parent.leftFirst      = leftChildIndex;
 
         // `parent' breaks
-        m_nodes.emplace_back();
-        m_nodes[leftChildIndex].leftFirst      = firstPrimitive;
-        m_nodes[leftChildIndex].primitiveCount = leftCount;
+        nodes.emplace_back();
+        nodes[leftChildIndex].leftFirst      = firstPrimitive;
+        nodes[leftChildIndex].primitiveCount = leftCount;
 
-        m_nodes.emplace_back();
-        m_nodes[rightChildIndex].leftFirst      = firstRightIndex;
-        m_nodes[rightChildIndex].primitiveCount = rightCount;
+        nodes.emplace_back();
+        nodes[rightChildIndex].leftFirst      = firstRightIndex;
+        nodes[rightChildIndex].primitiveCount = rightCount;
 
         // first, process the left child node (and all of its children)
-        computeAABB(m_nodes[leftChildIndex]);
-        subdivide(m_nodes[leftChildIndex]);
+        computeAABB(nodes[leftChildIndex]);
+        subdivide(nodes, leftChildIndex, depth + 1, deferred);
         // then, process the right child node (and all of its children)
-        computeAABB(m_nodes[rightChildIndex]);
-        subdivide(m_nodes[rightChildIndex]);
+        computeAABB(nodes[rightChildIndex]);
+        subdivide(nodes, rightChildIndex, depth + 1, deferred);
+    }
+
+    /// @brief The number of bins used by the spatial split builder along each
+    /// axis, for both object and spatial splits.
+    static constexpr int SplitBins = 16;
+
+    /// @brief Returns the SAH cost of a side of a split, which is zero for
+    /// sides without children (whose empty bounds have infinite area).
+    float sideCost(const Bounds &bounds, int count) const {
+        return count > 0 ? (float) count * surfaceArea(bounds) : 0;
     }
 
+    /// @brief Returns the surface area of the overlap of two bounding boxes.
+    float overlapArea(const Bounds &a, const Bounds &b) const {
+        const Bounds overlap(elementwiseMax(a.min(), b.min()),
+                             elementwiseMin(a.max(), b.max()));
+        for (int dim = 0; dim < 3; dim++) {
+            if (!(overlap.min()[dim] <= overlap.max()[dim]))
+                return 0;
+        }
+        return surfaceArea(overlap);
+    }
+
+    /// @brief Returns the object split bin of a reference.
+    static int objectBin(const Reference &ref, int axis, float binMin,
+                         float binScale) {
+        return std::min((int) ((ref.bounds.center()[axis] - binMin) * binScale),
+                        SplitBins - 1);
+    }
+
+    /// @brief Finds the best split of references by their centroids along
+    /// any axis using binned SAH.
+    Split findObjectSplit(const std::vector<Reference> &refs) const {
+        Bounds centroidBounds;
+        for (const Reference &ref : refs)
+            centroidBounds.extend(ref.bounds.center());
+
+        Split best;
+        for (int axis = 0; axis < 3; axis++) {
+            const float binMin = centroidBounds.min()[axis];
+            const float extent = centroidBounds.diagonal()[axis];
+            if (!(extent > 0))
+                continue;
+
+            const float binScale = SplitBins / extent;
+            Bin bins[SplitBins];
+            for (const Reference &ref : refs) {
+                Bin &bin = bins[objectBin(ref, axis, binMin, binScale)];
+                bin.count++;
+                bin.bounds.extend(ref.bounds);
+            }
+
+            Bounds rightBounds[SplitBins];
+            int rightCount[SplitBins];
+            rightBounds[SplitBins - 1] = bins[SplitBins - 1].bounds;
+            rightCount[SplitBins - 1]  = bins[SplitBins - 1].count;
+            for (int i = SplitBins - 2; i > 0; i--) {
+                rightBounds[i] = rightBounds[i + 1];
+                rightBounds[i].extend(bins[i].bounds);
+                rightCount[i] = rightCount[i + 1] + bins[i].count;
+            }
+
+            Bounds leftBounds;
+            int leftCount = 0;
+            for (int i = 0; i < SplitBins - 1; i++) {
+                leftBounds.extend(bins[i].bounds);
+                leftCount += bins[i].count;
+
+                const float cost = sideCost(leftBounds, leftCount) +
+                                   sideCost(rightBounds[i + 1], rightCount[i + 1]);
+                if (leftCount > 0 && rightCount[i + 1] > 0 && cost < best.cost) {
+                    best.cost        = cost;
+                    best.axis        = axis;
+                    best.binMin      = binMin;
+                    best.binScale    = binScale;
+                    best.bin         = i;
+                    best.leftBounds  = leftBounds;
+                    best.rightBounds = rightBounds[i + 1];
+                }
+            }
+        }
+        return best;
+    }
+
+    /**
+     * @brief Finds the best spatial split of references along any axis, by
+     * clipping each reference against the planes between the bins it
+     * overlaps.
+     */
+    Split findSpatialSplit(const Bounds &nodeBounds,
+                           const std::vector<Reference> &refs) const {
+        /// @brief A bin of the spatial split search, which counts how many
+        /// references start and end in it.
+        struct SpatialBin {
+            Bounds bounds;
+            int entries = 0;
+            int exits   = 0;
+        };
+
+        Split best;
+        for (int axis = 0; axis < 3; axis++) {
+            const float binMin = nodeBounds.min()[axis];
+            const float extent = nodeBounds.diagonal()[axis];
+            if (!(extent > 0))
+                continue;
+
+            const float binScale = SplitBins / extent;
+            const auto binIndex  = [&](float x) {
+                return std::clamp((int) ((x - binMin) * binScale), 0,
+                                  SplitBins - 1);
+            };
+            const auto planePosition = [&](int bin) {
+                return binMin + (float) (bin + 1) / binScale;
+            };
+
+            SpatialBin bins[SplitBins];
+            for (const Reference &ref : refs) {
+                const int first = binIndex(ref.bounds.min()[axis]);
+                const int last  = binIndex(ref.bounds.max()[axis]);
+                bins[first].entries++;
+                bins[last].exits++;
+
+                Bounds remaining = ref.bounds;
+                for (int bin = first; bin < last; bin++) {
+                    Bounds left, right;
+                    splitBoundingBox(ref.primitive, remaining, axis,
+                                     planePosition(bin), left, right);
+                    bins[bin].bounds.extend(left);
+                    remaining = right;
+                }
+                bins[last].bounds.extend(remaining);
+            }
+
+            Bounds rightBounds[SplitBins];
+            int rightCount[SplitBins];
+            rightBounds[SplitBins - 1] = bins[SplitBins - 1].bounds;
+            rightCount[SplitBins - 1]  = bins[SplitBins - 1].exits;
+            for (int i = SplitBins - 2; i > 0; i--) {
+                rightBounds[i] = rightBounds[i + 1];
+                rightBounds[i].extend(bins[i].bounds);
+                rightCount[i] = rightCount[i + 1] + bins[i].exits;
+            }
+
+            Bounds leftBounds;
+            int leftCount = 0;
+            for (int i = 0; i < SplitBins - 1; i++) {
+                leftBounds.extend(bins[i].bounds);
+                leftCount += bins[i].entries;
+
+                const float cost = sideCost(leftBounds, leftCount) +
+                                   sideCost(rightBounds[i + 1], rightCount[i + 1]);
+                if (leftCount > 0 && rightCount[i + 1] > 0 && cost < best.cost) {
+                    best.cost        = cost;
+                    best.axis        = axis;
+                    best.spatial     = true;
+                    best.position    = planePosition(i);
+                    best.leftBounds  = leftBounds;
+                    best.rightBounds = rightBounds[i + 1];
+                }
+            }
+        }
+        return best;
+    }
+
+    /**
+     * @brief Distributes references to the children of a spatial split.
+     * References that straddle the split plane are clipped and referenced
+     * from both children, unless keeping them on one side is cheaper
+     * ("reference unsplitting").
+     */
+    void performSpatialSplit(const std::vector<Reference> &refs,
+                             const Split &split, std::vector<Reference> &left,
+                             std::vector<Reference> &right) const {
+        Bounds leftBounds, rightBounds;
+        std::vector<const Reference *> straddling;
+        for (const Reference &ref : refs) {
+            if (ref.bounds.max()[split.axis] <= split.position) {
+                left.push_back(ref);
+                leftBounds.extend(ref.bounds);
+            } else if (ref.bounds.min()[split.axis] >= split.position) {
+                right.push_back(ref);
+                rightBounds.extend(ref.bounds);
+            } else {
+                straddling.push_back(&ref);
+            }
+        }
+
+        for (const Reference *ref : straddling) {
+            Bounds leftPart, rightPart;
+            splitBoundingBox(ref->primitive, ref->bounds, split.axis,
+                             split.position, leftPart, rightPart);
+
+            const int leftCount  = int(left.size());
+            const int rightCount = int(right.size());
+            Bounds splitLeft = leftBounds, splitRight = rightBounds;
+            splitLeft.extend(leftPart);
+            splitRight.extend(rightPart);
+            Bounds unsplitLeft = leftBounds, unsplitRight = rightBounds;
+            unsplitLeft.extend(ref->bounds);
+            unsplitRight.extend(ref->bounds);
+
+            // the clipped parts can be empty if the child only touches the
+            // split plane, in which case it belongs to the other side
+            const bool hasLeft  = leftPart.min()[split.axis] <= leftPart.max()[split.axis];
+            const bool hasRight = rightPart.min()[split.axis] <= rightPart.max()[split.axis];
+            const float splitCost =
+                hasLeft && hasRight
+                    ? sideCost(splitLeft, leftCount + 1) +
+                          sideCost(splitRight, rightCount + 1)
+                    : Infinity;
+            const float leftCost = sideCost(unsplitLeft, leftCount + 1) +
+                                   sideCost(rightBounds, rightCount);
+            const float rightCost = sideCost(leftBounds, leftCount) +
+                                    sideCost(unsplitRight, rightCount + 1);
+
+            if (splitCost < leftCost && splitCost < rightCost) {
+                left.push_back({ leftPart, ref->primitive });
+                right.push_back({ rightPart, ref->primitive });
+                leftBounds  = splitLeft;
+                rightBounds = splitRight;
+            } else if (leftCost <= rightCost) {
+                left.push_back(*ref);
+                leftBounds = unsplitLeft;
+            } else {
+                right.push_back(*ref);
+                rightBounds = unsplitRight;
+            }
+        }
+    }
+
+    /**
+     * @brief Recursively builds the BVH node at @c nodeIndex over the given
+     * references, choosing between object splits and spatial splits (SBVH).
+     * Leaves append their children to m_primitiveIndices, which hence may
+     * contain children more than once.
+     * @param primitiveIndices Receives the children of all leaves.
+     * @param minOverlap The overlap area of object split children above which
+     * spatial splits are considered.
+     * @param deferred If given, nodes with fewer than SubtreeTaskThreshold
+     * references are not subdivided any further, but are recorded (like in
+     * @ref subdivide ) so that they can be built as independent tasks.
+     */
+    void buildSpatialSplitNode(std::vector<Node> &nodes,
+                               std::vector<int> &primitiveIndices,
+                               NodeIndex nodeIndex, std::vector<Reference> refs,
+                               int depth, float minOverlap,
+                               std::vector<SpatialSplitTask> *deferred =
+                                   nullptr) {
+        Bounds aabb;
+        for (const Reference &ref : refs)
+            aabb.extend(ref.bounds);
+        nodes[nodeIndex].aabb = aabb;
+
+        const auto makeLeaf = [&]() {
+            nodes[nodeIndex].leftFirst      = NodeIndex(primitiveIndices.size());
+            nodes[nodeIndex].primitiveCount = NodeIndex(refs.size());
+            for (const Reference &ref : refs)
+                primitiveIndices.push_back(ref.primitive);
+        };
+
+        // only subdivide if enough children are available.
+        if (refs.size() <= 2 || depth >= MaxDepth)
+            return makeLeaf();
+
+        if (deferred && refs.size() < size_t(SubtreeTaskThreshold)) {
+            deferred->push_back({ nodeIndex, depth, std::move(refs) });
+            return;
+        }
+
+        Split split = findObjectSplit(refs);
+        // clipping only pays off if the children of the object split overlap
+        // considerably, which also bounds the number of duplicated references
+        if (!(split.cost < Infinity) ||
+            overlapArea(split.leftBounds, split.rightBounds) > minOverlap) {
+            const Split spatialSplit = findSpatialSplit(aabb, refs);
+            if (spatialSplit.cost < split.cost)
+                split = spatialSplit;
+        }
+
+        // unlike the object split builder, we account for the cost of
+        // traversing the node, as references would otherwise be duplicated
+        // all the way down to single children
+        if (!(split.cost + surfaceArea(aabb) <= sideCost(aabb, int(refs.size()))))
+            return makeLeaf();
+
+        std::vector<Reference> left, right;
+        if (split.spatial) {
+            performSpatialSplit(refs, split, left, right);
+        } else {
+            for (const Reference &ref : refs) {
+                if (objectBin(ref, split.axis, split.binMin, split.binScale) <=
+                    split.bin) {
+                    left.push_back(ref);
+                } else {
+                    right.push_back(ref);
+                }
+            }
+        }
+
+        if (left.empty() || right.empty()) {
+            // if either child gets no primitives, we abort subdividing
+            return makeLeaf();
+        }
+        refs.clear();
+        refs.shrink_to_fit();
+
+        // the two children will always be contiguous in our nodes list
+        const auto leftChildIndex       = (NodeIndex) (nodes.size() + 0);
+        const auto rightChildIndex      = (NodeIndex) (nodes.size() + 1);
+        nodes[nodeIndex].primitiveCount = 0;
+        nodes[nodeIndex].leftFirst      = leftChildIndex;
+        nodes.resize(nodes.size() + 2);
+
+        buildSpatialSplitNode(nodes, primitiveIndices, leftChildIndex,
+                              std::move(left), depth + 1, minOverlap, deferred);
+        buildSpatialSplitNode(nodes, primitiveIndices, rightChildIndex,
+                              std::move(right), depth + 1, minOverlap,
+                              deferred);
+    }
+
+    /**
+     * @brief Builds the BVH with object splits. The top levels of the tree are
+     * split on the calling thread (binning large nodes in parallel), after
+     * which the remaining subtrees are built as independent tasks. The result
+     * is identical to a serial build.
+     * @return The number of subtree tasks.
+     */
+    int buildWithObjectSplits() {
+        // fill primitive indices with 0 to primitiveCount - 1
+        m_primitiveIndices.resize(numberOfPrimitives());
+        std::iota(m_primitiveIndices.begin(), m_primitiveIndices.end(), 0);
+
+        // create root node
+        auto &root          = m_nodes.emplace_back();
+        root.leftFirst      = 0;
+        root.primitiveCount = numberOfPrimitives();
+        computeAABB(root);
+
+        // small structures are not worth the overhead of spawning tasks
+        std::vector<std::pair<NodeIndex, int>> deferred;
+        subdivide(m_nodes, 0, 0,
+                  root.primitiveCount >= SubtreeTaskThreshold ? &deferred
+                                                              : nullptr);
+
+        if (!deferred.empty()) {
+            // every task owns a disjoint range of m_primitiveIndices, so they
+            // can be partitioned without synchronization
+            std::vector<std::vector<Node>> tasks(deferred.size());
+            for_each_parallel(Range(0, int(deferred.size())), [&](int task) {
+                const auto [node, depth] = deferred[task];
+                tasks[task].push_back(m_nodes[node]);
+                subdivide(tasks[task], 0, depth);
+            });
+
+            std::unordered_map<NodeIndex, std::vector<Node>> subtrees;
+            size_t nodeCount = m_nodes.size();
+            for (size_t task = 0; task < deferred.size(); task++) {
+                nodeCount += tasks[task].size() - 1;
+                subtrees[deferred[task].first] = std::move(tasks[task]);
+            }
+
+            std::vector<Node> nodes(1);
+            nodes.reserve(nodeCount);
+            stitchSubtree(nodes, 0, m_nodes, 0, &subtrees);
+            m_nodes = std::move(nodes);
+        }
+        return int(deferred.size());
+    }
+
+    /**
+     * @brief Builds the BVH with spatial splits (SBVH). The top levels of the
+     * tree are split on the calling thread, after which the remaining subtrees
+     * are built as independent tasks, each of which collects the children of
+     * its leaves separately.
+     * @return The number of subtree tasks.
+     */
+    int buildWithSpatialSplits() {
+        std::vector<Reference> refs(numberOfPrimitives());
+        Bounds rootBounds;
+        for (int primitive = 0; primitive < int(refs.size()); primitive++) {
+            refs[primitive] = { getBoundingBox(primitive), primitive };
+            rootBounds.extend(refs[primitive].bounds);
+        }
+
+        m_nodes.assign(1, Node{});
+        m_primitiveIndices.clear();
+        const float minOverlap = m_spatialSplitAlpha * surfaceArea(rootBounds);
+
+        // small structures are not worth the overhead of spawning tasks
+        std::vector<SpatialSplitTask> deferred;
+        buildSpatialSplitNode(
+            m_nodes, m_primitiveIndices, 0, std::move(refs), 0, minOverlap,
+            numberOfPrimitives() >= SubtreeTaskThreshold ? &deferred : nullptr);
+        if (deferred.empty())
+            return 0;
+
+        std::vector<std::vector<Node>> tasks(deferred.size());
+        std::vector<std::vector<int>> taskPrimitives(deferred.size());
+        for_each_parallel(Range(0, int(deferred.size())), [&](int task) {
+            tasks[task].push_back(m_nodes[deferred[task].node]);
+            buildSpatialSplitNode(tasks[task], taskPrimitives[task], 0,
+                                  std::move(deferred[task].refs),
+                                  deferred[task].depth, minOverlap);
+        });
+
+        // leaves of the tasks refer to their own lists of children, which are
+        // appended to the list of the whole structure
+        std::unordered_map<NodeIndex, std::vector<Node>> subtrees;
+        size_t nodeCount = m_nodes.size();
+        for (size_t task = 0; task < deferred.size(); task++) {
+            const auto offset = NodeIndex(m_primitiveIndices.size());
+            for (Node &node : tasks[task]) {
+                if (node.isLeaf())
+                    node.leftFirst += offset;
+            }
+            m_primitiveIndices.insert(m_primitiveIndices.end(),
+                                      taskPrimitives[task].begin(),
+                                      taskPrimitives[task].end());
+            nodeCount += tasks[task].size() - 1;
+            subtrees[deferred[task].node] = std::move(tasks[task]);
+        }
+
+        std::vector<Node> nodes(1);
+        nodes.reserve(nodeCount);
+        stitchSubtree(nodes, 0, m_nodes, 0, &subtrees);
+        m_nodes = std::move(nodes);
+        return int(deferred.size());
+    }
+
+    /// @brief Computes the SAH cost of a BVH relative to its root, assuming
+    /// unit cost for visiting a node and for intersecting a child.
+    float computeSAHCost(const std::vector<Node> &nodes) const {
+        float cost = 0;
+        for (const Node &node : nodes) {
+            cost += surfaceArea(node.aabb) *
+                    (node.isLeaf() ? (float) node.primitiveCount : 1.0f);
+        }
+        return cost / surfaceArea(nodes.front().aabb);
+    }
+
+    /**
+     * @brief Copies the subtree rooted at @c source to @c target in @c result ,
+     * appending its descendants in the order the serial @ref subdivide would
+     * have created them in.
+     * @param subtrees If given, maps nodes of @c nodes to the separately built
+     * subtrees that replace them.
+     */
+    void stitchSubtree(std::vector<Node> &result, NodeIndex target,
+                       const std::vector<Node> &nodes, NodeIndex source,
+                       const std::unordered_map<NodeIndex, std::vector<Node>>
+                           *subtrees) const {
+        if (subtrees) {
+            const auto subtree = subtrees->find(source);
+            if (subtree != subtrees->end()) {
+                stitchSubtree(result, target, subtree->second, 0, nullptr);
+                return;
+            }
+        }
+
+        result[target] = nodes[source];
+        if (nodes[source].isLeaf())
+            return;
+
+        const auto leftChildIndex = (NodeIndex) result.size();
+        result[target].leftFirst  = leftChildIndex;
+        result.resize(result.size() + 2);
+        stitchSubtree(result, leftChildIndex + 0, nodes,
+                      nodes[source].leftChildIndex(), subtrees);
+        stitchSubtree(result, leftChildIndex + 1, nodes,
+                      nodes[source].rightChildIndex(), subtrees);
+    }
+
+    /**
+     * @brief Appends the subtree rooted at the given node of m_nodes to
+     * m_flatNodes in depth-first order.
+     * @return The index of the node in m_flatNodes.
+     */
+    NodeIndex flattenNode(NodeIndex index) {
+        const Node &node          = m_nodes[index];
+        const NodeIndex flatIndex = (NodeIndex) m_flatNodes.size();
+        m_flatNodes.push_back({ node.aabb, node.leftFirst, node.primitiveCount });
+        if (!node.isLeaf()) {
+            flattenNode(node.leftChildIndex());
+            m_flatNodes[flatIndex].offset = flattenNode(node.rightChildIndex());
+        }
+        return flatIndex;
+    }
+
+    /**
+     * @brief Collapses the subtree rooted at the given node of m_nodes into
+     * wide nodes. Children are gathered by repeatedly opening the internal
+     * child with the largest surface area, until @c Width children are found
+     * or only leaves remain.
+     * @return The index of the wide node in @c wideNodes .
+     */
+    template <int Width>
+    NodeIndex collapseNode(std::vector<WideNode<Width>> &wideNodes,
+                           NodeIndex index) const {
+        NodeIndex children[Width];
+        int childCount = 0;
+        if (m_nodes[index].isLeaf()) {
+            // only happens for the root, which still needs a wide node
+            children[childCount++] = index;
+        } else {
+            children[childCount++] = m_nodes[index].leftChildIndex();
+            children[childCount++] = m_nodes[index].rightChildIndex();
+        }
+
+        while (childCount < Width) {
+            int largest       = -1;
+            float largestArea = -Infinity;
+            for (int i = 0; i < childCount; i++) {
+                const Node &child = m_nodes[children[i]];
+                if (!child.isLeaf() && surfaceArea(child.aabb) > largestArea) {
+                    largest     = i;
+                    largestArea = surfaceArea(child.aabb);
+                }
+            }
+            if (largest < 0)
+                break;
+
+            const Node &opened     = m_nodes[children[largest]];
+            children[largest]      = opened.leftChildIndex();
+            children[childCount++] = opened.rightChildIndex();
+        }
+
+        const auto wideIndex = (NodeIndex) wideNodes.size();
+        wideNodes.emplace_back();
+        for (int slot = 0; slot < Width; slot++) {
+            Bounds aabb              = Bounds::empty();
+            NodeIndex offset         = 0;
+            NodeIndex primitiveCount = 0;
+            if (slot < childCount) {
+                const Node &child = m_nodes[children[slot]];
+                aabb              = child.aabb;
+                if (child.isLeaf()) {
+                    offset         = child.firstPrimitiveIndex();
+                    primitiveCount = child.primitiveCount;
+                } else {
+                    offset = collapseNode(wideNodes, children[slot]);
+                }
+            }
+
+            // the recursion above may have reallocated wideNodes
+            auto &node = wideNodes[wideIndex];
+            for (int dim = 0; dim < 3; dim++) {
+                node.bounds[0][dim][slot] = aabb.min()[dim];
+                node.bounds[1][dim][slot] = aabb.max()[dim];
+            }
+            node.offset[slot]         = offset;
+            node.primitiveCount[slot] = primitiveCount;
+        }
+        return wideIndex;
+    }
+
+public:
+    /**
+     * @brief The settings that determine how an acceleration structure is
+     * built and traversed.
+     * The branching factor is read from the "bvh" property, which is either
+     * "binary" (the default), "bvh4" or "bvh8". Spatial splits are enabled
+     * through the "sbvh" property, with "sbvhAlpha" controlling how many
+     * references may be duplicated. Unless "sbvhCompare" is disabled, the BVH
+     * is additionally built with object splits only, to report how much
+     * spatial splits improve on it (which takes about a tenth of the time of
+     * building with spatial splits).
+     */
+    struct Settings {
+        int width                 = 2;
+        bool spatialSplits        = false;
+        float spatialSplitAlpha   = 1e-5f;
+        bool compareSpatialSplits = true;
+
+        Settings(const Properties &properties) {
+            width = properties.getEnum<int>(
+                "bvh", width,
+                { { "binary", 2 }, { "bvh4", 4 }, { "bvh8", 8 } });
+            spatialSplits = properties.get<bool>("sbvh", spatialSplits);
+            spatialSplitAlpha =
+                properties.get<float>("sbvhAlpha", spatialSplitAlpha);
+            compareSpatialSplits =
+                properties.get<bool>("sbvhCompare", compareSpatialSplits);
+        }
+
+        auto operator<=>(const Settings &other) const = default;
+    };
+
 protected:
+    AccelerationStructure(const Settings &settings)
+        : m_width(settings.width), m_spatialSplits(settings.spatialSplits),
+          m_spatialSplitAlpha(settings.spatialSplitAlpha),
+          m_compareSpatialSplits(settings.compareSpatialSplits) {}
+
+    AccelerationStructure(const Properties &properties)
+        : AccelerationStructure(Settings(properties)) {}
+
     /// @brief Returns the number of children (individual shapes) that are part
     /// of this acceleration structure.
     virtual int numberOfPrimitives() const = 0;
@@ -356,29 +1365,153 @@ protected:
     /// ray.
     virtual bool intersect(int primitiveIndex, const Ray &ray,
                            Intersection &its, Sampler &rng) const = 0;
+    /**
+     * @brief Tests whether a single child (identified by the index) blocks the
+     * given ray anywhere closer than @c tMax .
+     * The default implementation falls back to a full intersection, but
+     * shapes can override this to skip computing shading data.
+     */
+    virtual bool occluded(int primitiveIndex, const Ray &ray, float tMax,
+                          Sampler &rng) const {
+        Intersection its(-ray.direction, tMax);
+        return intersect(primitiveIndex, ray, its, rng);
+    }
+    /**
+     * @brief Intersects all children of a BVH leaf, which are given as the
+     * range [first, first + count) of the leaf order (see @ref
+     * primitiveIndex ).
+     * The default implementation intersects the children one at a time;
+     * shapes can override this to store their children in leaf order.
+     */
+    virtual bool intersectLeaf(int first, int count, const Ray &ray,
+                               Intersection &its, Sampler &rng) const {
+        bool wasIntersected = false;
+        for (int reference = first; reference < first + count; reference++)
+            wasIntersected |=
+                intersect(m_primitiveIndices[reference], ray, its, rng);
+        return wasIntersected;
+    }
+    /**
+     * @brief Returns the fraction of light that passes through a single child
+     * (identified by the index) along the given ray up to @c tMax .
+     * The default implementation treats the child as opaque.
+     */
+    virtual float transmittance(int primitiveIndex, const Ray &ray, float tMax,
+                                Sampler &rng) const {
+        return occluded(primitiveIndex, ray, tMax, rng) ? 0.f : 1.f;
+    }
+    /// @brief Tests whether any child of a BVH leaf blocks the given ray.
+    /// @see intersectLeaf
+    virtual bool occludedLeaf(int first, int count, const Ray &ray,
+                              float tMax, Sampler &rng) const {
+        for (int reference = first; reference < first + count; reference++) {
+            if (occluded(m_primitiveIndices[reference], ray, tMax, rng))
+                return true;
+        }
+        return false;
+    }
     /// @brief Returns the axis aligned bounding box of the given child.
+    /// @note Called concurrently from multiple threads during construction.
     virtual Bounds getBoundingBox(int primitiveIndex) const = 0;
     /// @brief Returns the centroid of the given child.
+    /// @note Called concurrently from multiple threads during construction.
     virtual Point getCentroid(int primitiveIndex) const = 0;
+    /**
+     * @brief Splits the part of the given child that lies within @c bounds at
+     * an axis aligned plane, reporting the bounding boxes of the parts on
+     * either side (used for spatial splits).
+     * The default implementation cuts @c bounds itself, which is conservative
+     * for any shape; shapes can override this to clip their geometry instead.
+     */
+    virtual void splitBoundingBox(int primitiveIndex, const Bounds &bounds,
+                                  int axis, float position, Bounds &left,
+                                  Bounds &right) const {
+        left = right       = bounds;
+        left.max()[axis]  = std::min(left.max()[axis], position);
+        right.min()[axis] = std::max(right.min()[axis], position);
+    }
+
+    /**
+     * @brief Returns the number of child references in the leaf order of the
+     * BVH. This can exceed the number of children if spatial splits are used.
+     */
+    int numberOfReferences() const { return int(m_primitiveIndices.size()); }
+    /**
+     * @brief Returns the child at the given position of the leaf order, in
+     * which the children of every BVH leaf are contiguous.
+     * @note Only valid once the acceleration structure has been built.
+     */
+    int primitiveIndex(int reference) const {
+        return m_primitiveIndices[reference];
+    }
 
-    /// @brief Builds the acceleration structure.
+    /**
+     * @brief Builds the acceleration structure, with object splits or (if
+     * enabled) spatial splits, and converts it to the layout used for
+     * traversal.
+     */
     void buildAccelerationStructure() {
         Timer buildTimer;
 
-        // fill primitive indices with 0 to primitiveCount - 1
-        m_primitiveIndices.resize(numberOfPrimitives());
-        std::iota(m_primitiveIndices.begin(), m_primitiveIndices.end(), 0);
+        int subtreeTasks;
+        if (m_spatialSplits && numberOfPrimitives() > 0) {
+            // the cost of the object split BVH serves as baseline
+            float objectSplitCost = 0;
+            if (m_compareSpatialSplits) {
+                buildWithObjectSplits();
+                objectSplitCost = computeSAHCost(m_nodes);
+                m_nodes.clear();
+            }
 
-        // create root node
-        auto &root          = m_nodes.emplace_back();
-        root.leftFirst      = 0;
-        root.primitiveCount = numberOfPrimitives();
-        computeAABB(root);
-        subdivide(root);
+            subtreeTasks     = buildWithSpatialSplits();
+            const float cost = computeSAHCost(m_nodes);
+            if (m_compareSpatialSplits) {
+                logger(EInfo,
+                       "spatial splits created %ld references for %ld "
+                       "primitives (alpha %g), SAH cost %.2f instead of %.2f "
+                       "with object splits only (%.2f lower, %.1f%%)",
+                       m_primitiveIndices.size(), numberOfPrimitives(),
+                       m_spatialSplitAlpha, cost, objectSplitCost,
+                       objectSplitCost - cost,
+                       100 * (objectSplitCost - cost) / objectSplitCost);
+            } else {
+                logger(EInfo,
+                       "spatial splits created %ld references for %ld "
+                       "primitives (alpha %g), SAH cost %.2f",
+                       m_primitiveIndices.size(), numberOfPrimitives(),
+                       m_spatialSplitAlpha, cost);
+            }
+        } else {
+            subtreeTasks = buildWithObjectSplits();
+        }
+
+        // convert to the layout used for traversal (note that the root of an
+        // empty structure is not a leaf, but has no children either, and is
+        // never traversed)
+        m_aabb = m_nodes.front().aabb;
+        size_t nodeCount = 0;
+        if (!m_primitiveIndices.empty()) {
+            if (m_width == 4) {
+                collapseNode(m_wideNodes4, 0);
+                nodeCount = m_wideNodes4.size();
+            } else if (m_width == 8) {
+                collapseNode(m_wideNodes8, 0);
+                nodeCount = m_wideNodes8.size();
+            } else {
+                m_flatNodes.reserve(m_nodes.size());
+                flattenNode(0);
+                nodeCount = m_flatNodes.size();
+            }
+        }
+        m_nodes.clear();
+        m_nodes.shrink_to_fit();
 
-        logger(EInfo, "built BVH with %ld nodes for %ld primitives in %.1f ms",
-               m_nodes.size(), numberOfPrimitives(),
-               buildTimer.getElapsedTime() * 1000);
+        logger(EInfo,
+               "built %d-wide BVH with %ld nodes for %ld primitives in %.1f ms "
+               "(%d threads, %d subtree tasks)",
+               m_width, nodeCount, numberOfPrimitives(),
+               buildTimer.getElapsedTime() * 1000, numberOfThreads(),
+               subtreeTasks);
     }
 
 public:
@@ -386,15 +1519,89 @@ public:
                    Sampler &rng) const override {
         if (m_primitiveIndices.empty())
             return false; // exit early if no children exist
-        if (intersectAABB(rootNode().aabb, ray) <
-            its.t) // test root bounding box for potential hit
-            return intersectNode(rootNode(), ray, its, rng);
-        return false;
+
+        bool wasIntersected = false;
+        traverse(ray, its.t, its.stats.bvhCounter,
+                 [&](NodeIndex first, NodeIndex count) {
+                     // update the statistic tracking how many children have
+                     // been tested for intersection
+                     its.stats.primCounter += count;
+                     // test the children for intersection
+                     wasIntersected |= intersectLeaf(first, count, ray, its, rng);
+                     return false;
+                 });
+        return wasIntersected;
+    }
+
+    bool occluded(const Ray &ray, float tMax,
+                  Sampler &rng) const override {
+        if (m_primitiveIndices.empty())
+            return false;
+
+        // the order in which leaves are visited does not matter here, since
+        // any blocking child lets us stop right away
+        int nodeCounter = 0;
+        return traverse(ray, tMax, nodeCounter,
+                        [&](NodeIndex first, NodeIndex count) {
+                            return occludedLeaf(first, count, ray, tMax, rng);
+                        });
+    }
+
+    float transmittance(const Ray &ray, float tMax,
+                        Sampler &rng) const override {
+        if (m_primitiveIndices.empty())
+            return 1;
+
+        // spatial splits can place a child in several leaves along the ray,
+        // hence children are remembered so that their (randomly estimated)
+        // transmittance is not accounted for twice. Shadow rays rarely pass
+        // more than a few children, which are kept on the stack; only the
+        // children beyond those are kept in a sorted list on the heap
+        constexpr int InlineVisits = 16;
+        int inlineVisited[InlineVisits];
+        int numInlineVisited = 0;
+        std::vector<int> visited;
+        const auto firstVisit = [&](int primitive) {
+            for (int i = 0; i < numInlineVisited; i++) {
+                if (inlineVisited[i] == primitive)
+                    return false;
+            }
+            if (numInlineVisited < InlineVisits) {
+                inlineVisited[numInlineVisited++] = primitive;
+                return true;
+            }
+            const auto it =
+                std::lower_bound(visited.begin(), visited.end(), primitive);
+            if (it != visited.end() && *it == primitive)
+                return false;
+            visited.insert(it, primitive);
+            return true;
+        };
+
+        float result    = 1;
+        int nodeCounter = 0;
+        traverse(ray, tMax, nodeCounter, [&](NodeIndex first, NodeIndex count) {
+            for (NodeIndex reference = first; reference < first + count;
+                 reference++) {
+                const int primitive = m_primitiveIndices[reference];
+                if (m_spatialSplits && !firstVisit(primitive))
+                    continue;
+
+                const float value = transmittance(primitive, ray, tMax, rng);
+                if (value == 0) {
+                    result = 0;
+                    return true;
+                }
+                result *= value;
+            }
+            return false;
+        });
+        return result;
     }
 
-    Bounds getBoundingBox() const override { return rootNode().aabb; }
+    Bounds getBoundingBox() const override { return m_aabb; }
 
-    Point getCentroid() const override { return rootNode().aabb.center(); }
+    Point getCentroid() const override { return m_aabb.center(); }
 };
 
 } // namespace lightwave
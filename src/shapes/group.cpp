@@ -21,6 +21,14 @@ protected:
         return m_children[primitiveIndex]->intersect(ray, its, rng);
     }
 
+    bool occluded(int primitiveIndex, const Ray &ray, float tMax, Sampler &rng) const override {
+        return m_children[primitiveIndex]->occluded(ray, tMax, rng);
+    }
+
+    float transmittance(int primitiveIndex, const Ray &ray, float tMax, Sampler &rng) const override {
+        return m_children[primitiveIndex]->transmittance(ray, tMax, rng);
+    }
+
     Bounds getBoundingBox(int primitiveIndex) const override {
         return m_children[primitiveIndex]->getBoundingBox();
     }
@@ -30,7 +38,7 @@ protected:
     }
 
 public:
-    Group(const Properties &properties) {
+    Group(const Properties &properties) : AccelerationStructure(properties) {
         m_children = properties.getChildren<Shape>();
         buildAccelerationStructure();
     }
@@ -39,6 +47,10 @@ public:
         for (auto &child : m_children) child->markAsVisible();
     }
 
+    void collectInstances(std::vector<const Instance *> &instances) const override {
+        for (auto &child : m_children) child->collectInstances(instances);
+    }
+
     AreaSample sampleArea(Sampler &rng) const override {
         int childIndex = int(rng.next() * m_children.size());
         childIndex = std::min(childIndex, int(m_children.size()) - 1);
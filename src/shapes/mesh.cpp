@@ -1,4 +1,6 @@
 #include <lightwave.hpp>
+#include <map>
+#include <mutex>
 #include <tuple>
 
 #include "../core/plyparser.hpp"
@@ -30,9 +32,43 @@ class TriangleMesh : public AccelerationStructure {
     /// @brief Whether to interpolate the normals from m_vertices, or report the geometric normal instead.
     bool m_smoothNormals;
 
-    static inline void populate(SurfaceEvent &surf) {
+    /// @brief The data needed to test a triangle for intersection, with the edges precomputed.
+    struct PrecomputedTriangle {
+        Point v0;
+        Vector e1;
+        Vector e2;
+
+        PrecomputedTriangle(const Point &p0, const Point &p1, const Point &p2)
+            : v0(p0), e1(p1 - p0), e2(p2 - p0) {}
+    };
+    /**
+     * @brief The triangles in the leaf order of the BVH (see @ref primitiveIndex ), so that the triangles of a leaf
+     * can be intersected without indirections through the index and vertex buffers.
+     * Shading attributes are only fetched from m_vertices once a hit has been found.
+     */
+    std::vector<PrecomputedTriangle> m_leafTriangles;
+    /// @brief Picks triangles proportionally to their area, for uniform area sampling of the whole mesh.
+    AliasTable m_areaDistribution;
+    /// @brief The total surface area of all triangles.
+    float m_surfaceArea = 0;
+
+    inline void populate(SurfaceEvent &surf) const {
         buildOrthonormalBasis(surf.frame.normal, surf.frame.tangent, surf.frame.bitangent);
-        surf.pdf = 0.0f;
+        // since we sample the area uniformly, the pdf is given by 1/surfaceArea
+        surf.pdf = m_surfaceArea > 0 ? 1 / m_surfaceArea : 0;
+    }
+
+    /// @brief Builds the table used by @ref sampleArea .
+    void buildAreaDistribution() {
+        std::vector<float> areas(m_triangles.size());
+        double surfaceArea = 0;
+        for (int i = 0; i < int(m_triangles.size()); i++) {
+            auto [v0, v1, v2] = getTriangle(i);
+            areas[i] = (v1.position - v0.position).cross(v2.position - v0.position).length() / 2;
+            surfaceArea += areas[i];
+        }
+        m_areaDistribution = AliasTable(areas);
+        m_surfaceArea = float(surfaceArea);
     }
 
 protected:
@@ -40,12 +76,25 @@ protected:
         return int(m_triangles.size());
     }
 
-    // Paper reference https://cadxfem.org/inf/Fast%20MinimumStorage%20RayTriangle%20Intersection.pdf
-    bool intersect(int primitiveIndex, const Ray &ray, Intersection &its, Sampler &rng) const override {
-        auto [v0, v1, v2] = getTriangle(primitiveIndex);
+    /// @brief Returns the triangle with the given index, prepared for intersection tests.
+    PrecomputedTriangle precomputeTriangle(int primitiveIndex) const {
+        const Vector3i triangle = m_triangles[primitiveIndex];
+        return {
+            m_vertices[triangle.x()].position,
+            m_vertices[triangle.y()].position,
+            m_vertices[triangle.z()].position
+        };
+    }
 
-        const Vector e1_vec = v1.position - v0.position;
-        const Vector e2_vec = v2.position - v0.position;
+    /**
+     * @brief Tests a single triangle for intersection, without computing any shading data.
+     * @return Whether the triangle is hit between Epsilon and @c tMax , in which case @c t and @c bary are set.
+     */
+    // Paper reference https://cadxfem.org/inf/Fast%20MinimumStorage%20RayTriangle%20Intersection.pdf
+    static bool intersectTriangle(const PrecomputedTriangle &triangle, const Ray &ray, float tMax, float &t,
+                                  Vector2 &bary) {
+        const Vector &e1_vec = triangle.e1;
+        const Vector &e2_vec = triangle.e2;
 
         const Vector p_vec = ray.direction.cross(e2_vec);
         const float determinant = p_vec.dot(e1_vec);
@@ -53,7 +102,7 @@ protected:
         if (abs(determinant) < 1e-8) return false;
 
         const float inverse_determinant = 1.0f / determinant;
-        const Vector t_vec =  ray.origin - v0.position;
+        const Vector t_vec =  ray.origin - triangle.v0;
 
         const float bary_u = p_vec.dot(t_vec) * inverse_determinant;
 
@@ -66,36 +115,99 @@ protected:
 
         if (bary_v < 0.0 || bary_u + bary_v > 1.0) return false;
 
-        const float t = q_vec.dot(e2_vec) * inverse_determinant;
+        t = q_vec.dot(e2_vec) * inverse_determinant;
 
         if (t < Epsilon) return false;
 
-        if (t > its.t) return false;
-        its.t = t;
+        if (t > tMax) return false;
+        bary = Vector2(bary_u, bary_v);
+        return true;
+    }
+
+    /// @brief Fills in the shading data of a hit that has been found on the given triangle.
+    void populateHit(int primitiveIndex, const Vector2 &bary, const Ray &ray, Intersection &its) const {
+        auto [v0, v1, v2] = getTriangle(primitiveIndex);
 
         its.uv = interpolateBarycentric(
-                Vector2(bary_u, bary_v),
+                bary,
                 v0.texcoords,
                 v1.texcoords,
                 v2.texcoords
         );
 
+        its.frame.normal = computeNormal(bary, v0, v1, v2);
+        its.geometryNormal = geometryNormal(v0, v1, v2);
+        its.position = ray(its.t);
+        populate(its);
+    }
+
+    /// @brief Returns the normal of the plane of a triangle.
+    static Vector geometryNormal(const Vertex &v0, const Vertex &v1, const Vertex &v2) {
+        return (v1.position - v0.position).cross(v2.position - v0.position).normalized();
+    }
+
+    /// @brief Returns the interpolated normal if smooth normals are used, and the geometric normal otherwise.
+    Vector computeNormal(const Vector2 &bary, const Vertex &v0, const Vertex &v1, const Vertex &v2) const {
         if (m_smoothNormals) {
-            its.frame.normal = interpolateBarycentric(
-                    Vector2(bary_u, bary_v),
+            return interpolateBarycentric(
+                    bary,
                     v0.normal,
                     v1.normal,
                     v2.normal
             ).normalized();
-        } else {
-            its.frame.normal = e1_vec.cross(e2_vec).normalized();
         }
+        return geometryNormal(v0, v1, v2);
+    }
 
-        its.position = ray(its.t);
-        populate(its);
+    /// @brief Records a hit, whose shading data is only computed once it is known to be the closest one.
+    void deferHit(int primitiveIndex, const Vector2 &bary, Intersection &its) const {
+        its.deferred.shape = this;
+        its.deferred.primitiveIndex = primitiveIndex;
+        its.deferred.barycentrics = bary;
+    }
+
+    bool intersect(int primitiveIndex, const Ray &ray, Intersection &its, Sampler &rng) const override {
+        float t;
+        Vector2 bary;
+        if (!intersectTriangle(precomputeTriangle(primitiveIndex), ray, its.t, t, bary)) return false;
+        its.t = t;
+        deferHit(primitiveIndex, bary, its);
         return true;
     }
 
+    bool occluded(int primitiveIndex, const Ray &ray, float tMax, Sampler &rng) const override {
+        float t;
+        Vector2 bary;
+        return intersectTriangle(precomputeTriangle(primitiveIndex), ray, tMax, t, bary);
+    }
+
+    bool intersectLeaf(int first, int count, const Ray &ray, Intersection &its, Sampler &rng) const override {
+        int closest = -1;
+        Vector2 closestBary;
+        for (int reference = first; reference < first + count; reference++) {
+            float t;
+            Vector2 bary;
+            if (intersectTriangle(m_leafTriangles[reference], ray, its.t, t, bary)) {
+                its.t = t;
+                closest = reference;
+                closestBary = bary;
+            }
+        }
+
+        if (closest < 0) return false;
+        deferHit(primitiveIndex(closest), closestBary, its);
+        return true;
+    }
+
+    bool occludedLeaf(int first, int count, const Ray &ray, float tMax, Sampler &rng) const override {
+        for (int reference = first; reference < first + count; reference++) {
+            float t;
+            Vector2 bary;
+            if (intersectTriangle(m_leafTriangles[reference], ray, tMax, t, bary)) return true;
+        }
+        return false;
+    }
+
     Bounds getBoundingBox(int primitiveIndex) const override {
         auto [a, b, c] = getTriangle(primitiveIndex);
 
@@ -105,6 +217,36 @@ protected:
         };
     }
 
+    void splitBoundingBox(int primitiveIndex, const Bounds &bounds, int axis, float position, Bounds &left,
+                          Bounds &right) const override {
+        const Vector3i triangle = m_triangles[primitiveIndex];
+        const Point vertices[3] = {
+            m_vertices[triangle.x()].position,
+            m_vertices[triangle.y()].position,
+            m_vertices[triangle.z()].position
+        };
+
+        // walk along the edges, adding vertices to the side they lie on, and points where edges cross the plane to both
+        left = right = Bounds::empty();
+        for (int i = 0; i < 3; i++) {
+            const Point &a = vertices[i];
+            const Point &b = vertices[(i + 1) % 3];
+            if (a[axis] <= position) left.extend(a);
+            if (a[axis] >= position) right.extend(a);
+
+            if ((a[axis] < position && b[axis] > position) || (a[axis] > position && b[axis] < position)) {
+                Point crossing = a + (b - a) * ((position - a[axis]) / (b[axis] - a[axis]));
+                crossing[axis] = position;
+                left.extend(crossing);
+                right.extend(crossing);
+            }
+        }
+
+        // the triangle may already have been clipped by earlier splits
+        left = bounds.clip(left);
+        right = bounds.clip(right);
+    }
+
     Point getCentroid(int primitiveIndex) const override {
         const Vector3i triangle = m_triangles[primitiveIndex];
         return {
@@ -127,20 +269,90 @@ protected:
     }
 
 public:
-    TriangleMesh(const Properties &properties) {
-        m_originalPath = properties.get<std::filesystem::path>("filename");
-        m_smoothNormals = properties.get<bool>("smooth", true);
+    /// @brief Everything that determines the geometry and BVH of a mesh, used to share meshes between instances.
+    struct Key {
+        std::filesystem::path filename;
+        bool smooth;
+        Settings settings;
+
+        Key(const Properties &properties)
+            : filename(std::filesystem::weakly_canonical(properties.get<std::filesystem::path>("filename"))),
+              smooth(properties.get<bool>("smooth", true)),
+              settings(properties) {}
+
+        bool operator<(const Key &other) const {
+            return std::tie(filename, smooth, settings) < std::tie(other.filename, other.smooth, other.settings);
+        }
+    };
+
+    TriangleMesh(const Key &key) : AccelerationStructure(key.settings) {
+        m_originalPath = key.filename;
+        m_smoothNormals = key.smooth;
         readPLY(m_originalPath.string(), m_triangles, m_vertices);
         logger(EInfo, "loaded ply with %d triangles, %d vertices",
             m_triangles.size(),
             m_vertices.size()
         );
         buildAccelerationStructure();
+        buildAreaDistribution();
+
+        m_leafTriangles.reserve(numberOfReferences());
+        for (int reference = 0; reference < numberOfReferences(); reference++) {
+            m_leafTriangles.push_back(precomputeTriangle(primitiveIndex(reference)));
+        }
+    }
+
+    /**
+     * @brief Returns the mesh for the given properties, which is only loaded (and its BVH only built) the first time
+     * it is requested.
+     * Since meshes do not hold any per-instance state, all instances referencing the same file with the same settings
+     * share a single mesh, and only transform rays into its object space.
+     */
+    static ref<TriangleMesh> loadShared(const Properties &properties) {
+        static std::mutex mutex;
+        static std::map<Key, std::weak_ptr<TriangleMesh>> meshes;
+
+        const Key key(properties);
+        std::lock_guard lock(mutex);
+        // forget meshes that have been released since, so that scenes loaded one after another do not accumulate keys
+        std::erase_if(meshes, [](const auto &entry) { return entry.second.expired(); });
+        if (auto mesh = meshes[key].lock()) {
+            logger(EInfo, "reusing ply \"%s\"", key.filename.generic_string());
+            return mesh;
+        }
+
+        // do not use std::make_shared, so that the memory of the mesh is released as soon as it is no longer used
+        const auto mesh = ref<TriangleMesh>(new TriangleMesh(key));
+        meshes[key] = mesh;
+        return mesh;
+    }
+
+    void computeSurfaceInteraction(const Ray &ray, Intersection &its) const override {
+        populateHit(its.deferred.primitiveIndex, its.deferred.barycentrics, ray, its);
+        its.deferred.shape = nullptr;
+    }
+
+    float transmittance(const Ray &ray, float tMax, Sampler &rng) const override {
+        // triangles are opaque, so the leaf-ordered any-hit traversal suffices
+        return AccelerationStructure::occluded(ray, tMax, rng) ? 0.f : 1.f;
     }
 
     AreaSample sampleArea(Sampler &rng) const override {
-        // only implement this if you need triangle mesh area light sampling for your rendering competition
-        NOT_IMPLEMENTED
+        if (m_areaDistribution.empty()) return AreaSample::invalid();
+
+        const int primitiveIndex = m_areaDistribution.sample(rng.next());
+        const Vector2 bary = squareToUniformTriangle(rng.next2D());
+        auto [v0, v1, v2] = getTriangle(primitiveIndex);
+
+        AreaSample sample;
+        sample.position = interpolateBarycentric(bary, v0.position, v1.position, v2.position);
+        sample.uv = interpolateBarycentric(bary, v0.texcoords, v1.texcoords, v2.texcoords);
+        // the frame follows the triangle itself, since interpolated normals do not describe the surface on which the
+        // density is measured
+        sample.frame.normal = geometryNormal(v0, v1, v2);
+        sample.geometryNormal = sample.frame.normal;
+        populate(sample);
+        return sample;
     }
 
     std::string toString() const override {
@@ -159,4 +371,14 @@ public:
 
 }
 
-REGISTER_SHAPE(TriangleMesh, "mesh")
+// meshes are shared between instances, hence they cannot use REGISTER_SHAPE
+namespace lightwave {
+ref<Object> CreateTriangleMesh(const Properties &properties) {
+    try {
+        return TriangleMesh::loadShared(properties);
+    } catch (...) {
+        lightwave_throw_nested("while creating TriangleMesh object");
+    }
+}
+Registry::Registrar<TriangleMesh> r_TriangleMesh("shape", "mesh", CreateTriangleMesh);
+}
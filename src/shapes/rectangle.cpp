@@ -23,11 +23,86 @@ class Rectangle : public Shape {
         surf.frame.bitangent = Vector(0, 1, 0);
         // and accordingly, the normal always points in the positive z direction
         surf.frame.normal = Vector(0, 0, 1);
+        surf.geometryNormal = surf.frame.normal;
 
         // since we sample the area uniformly, the pdf is given by 1/surfaceArea
         surf.pdf = 1.0f / 4;
     }
 
+    /**
+     * @brief The projection of the rectangle onto the unit sphere around a point, which allows sampling the rectangle
+     * uniformly by solid angle.
+     * @see "An Area-Preserving Parametrization for Spherical Rectangles" (Urena et al., 2013)
+     */
+    struct SphericalRectangle {
+        /// @brief The point the rectangle is seen from.
+        Point origin;
+        /// @brief The extent of the rectangle relative to the origin, mirrored such that the origin lies above it.
+        float x0, x1, y0, y1, z0;
+        /// @brief Precomputed terms of the parametrization.
+        float b0, b1, k;
+        /// @brief The solid angle subtended by the rectangle.
+        float solidAngle;
+
+        SphericalRectangle(const Point &origin) : origin(origin) {
+            // corner [-1,-1,0] spanned by edges of length 2 along x and y
+            x0 = -1 - origin.x();
+            y0 = -1 - origin.y();
+            x1 = x0 + 2;
+            y1 = y0 + 2;
+            z0 = -std::abs(origin.z());
+
+            // normals of the planes through the origin and each edge of the rectangle
+            const Vector n0 = Vector(0, z0, -y0).normalized();
+            const Vector n1 = Vector(-z0, 0, x1).normalized();
+            const Vector n2 = Vector(0, -z0, y1).normalized();
+            const Vector n3 = Vector(z0, 0, -x0).normalized();
+
+            // the interior angles of the spherical rectangle
+            const float g0 = std::acos(std::clamp(-n0.dot(n1), -1.f, 1.f));
+            const float g1 = std::acos(std::clamp(-n1.dot(n2), -1.f, 1.f));
+            const float g2 = std::acos(std::clamp(-n2.dot(n3), -1.f, 1.f));
+            const float g3 = std::acos(std::clamp(-n3.dot(n0), -1.f, 1.f));
+
+            b0 = n0.z();
+            b1 = n2.z();
+            k = 2 * Pi - g2 - g3;
+            solidAngle = g0 + g1 - k;
+        }
+
+        /// @brief Very small or degenerate projections are numerically unstable, and are better sampled by area.
+        bool isUsable() const {
+            return z0 < 0 && std::isfinite(solidAngle) && solidAngle > MinSolidAngle;
+        }
+
+        /// @brief Maps a uniform random point in [0,1)^2 to a point on the rectangle.
+        Point sample(const Point2 &rnd) const {
+            // pick the x coordinate using the solid angle covered up to it
+            const float au = rnd.x() * solidAngle + k;
+            const float fu = (std::cos(au) * b0 - b1) / std::sin(au);
+            float cu = std::copysign(1.f, fu) / std::sqrt(sqr(fu) + sqr(b0));
+            cu = std::clamp(cu, -1.f, 1.f);
+            float xu = -(cu * z0) / safe_sqrt(1 - sqr(cu));
+            xu = std::clamp(xu, x0, x1);
+
+            // pick the y coordinate along the chosen line of the rectangle
+            const float d = std::sqrt(sqr(xu) + sqr(z0));
+            const float h0 = y0 / std::sqrt(sqr(d) + sqr(y0));
+            const float h1 = y1 / std::sqrt(sqr(d) + sqr(y1));
+            const float hv = h0 + rnd.y() * (h1 - h0);
+            const float hv2 = sqr(hv);
+            const float yv = hv2 < 1 - Epsilon ? (hv * d) / std::sqrt(1 - hv2) : y1;
+
+            return {
+                std::clamp(origin.x() + xu, -1.f, 1.f),
+                std::clamp(origin.y() + yv, -1.f, 1.f),
+                0,
+            };
+        }
+
+        static constexpr float MinSolidAngle = 3e-4f;
+    };
+
 public:
     Rectangle(const Properties &properties) {
     }
@@ -56,6 +131,7 @@ public:
         // we have determined there was an intersection! we are now free to change the intersection object and return true.
         its.t = t;
         populate(its, position); // compute the shading frame, texture coordinates and area pdf (same as sampleArea)
+        its.deferred.shape = nullptr; // our shading data is complete, so discard any deferred hit we replace
         return true;
     }
 
@@ -76,6 +152,32 @@ public:
         return sample;
     }
 
+    bool canSampleSolidAngle() const override { return true; }
+
+    AreaSample sampleSolidAngle(const Point &origin, Sampler &rng) const override {
+        const SphericalRectangle rectangle(origin);
+        if (!rectangle.isUsable()) {
+            AreaSample sample = sampleArea(rng);
+            sample.pdf = areaToSolidAngle(sample.pdf, origin, sample);
+            return sample;
+        }
+
+        AreaSample sample;
+        populate(sample, rectangle.sample(rng.next2D()));
+        sample.pdf = 1 / rectangle.solidAngle;
+        return sample;
+    }
+
+    float pdfSolidAngle(const Point &origin, const SurfaceEvent &surface) const override {
+        const SphericalRectangle rectangle(origin);
+        if (!rectangle.isUsable()) {
+            SurfaceEvent local;
+            populate(local, surface.position);
+            return areaToSolidAngle(local.pdf, origin, local);
+        }
+        return 1 / rectangle.solidAngle;
+    }
+
     std::string toString() const override {
         return "Rectangle[]";
     }
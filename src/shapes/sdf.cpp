@@ -9,6 +9,7 @@ class SDF : public Shape {
         surf.position = position;
         // This basis guarantees we get the normals correct, but the tangent space is less usable
         buildOrthonormalBasis(surf.frame.normal, surf.frame.tangent, surf.frame.bitangent);
+        surf.geometryNormal = surf.frame.normal;
 
         surf.pdf = 0.0f;
     }
@@ -43,6 +44,7 @@ public:
                 its.t = totalDist + dist;
                 Point p = ray(its.t);
                 populate(its, getNormal(Vector(p)), p);
+                its.deferred.shape = nullptr;
                 return true;
             }
 
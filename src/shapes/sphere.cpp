@@ -4,11 +4,21 @@ namespace lightwave {
 
 /// @brief A sphere with a given radius
 class Sphere : public Shape {
+    /// @brief Below this squared sine, cones are treated as small to avoid cancellation.
+    static constexpr float SmallConeThreshold = 0.00068523f; // sin^2(1.5 deg)
+
+    /// @brief Returns @code 1 - cos(thetaMax) @endcode for a cone given by its squared sine.
+    static float coneSize(float sin2ThetaMax) {
+        if (sin2ThetaMax < SmallConeThreshold) return sin2ThetaMax / 2;
+        return 1 - safe_sqrt(1 - sin2ThetaMax);
+    }
+
     static inline void populate(SurfaceEvent &surf, const Point &position) {
         surf.frame.normal = ((Vector) position).normalized();
         surf.position = surf.frame.normal;
         // Build an arbitrary orthonormal basis for the normal
         buildOrthonormalBasis(surf.frame.normal, surf.frame.tangent, surf.frame.bitangent);
+        surf.geometryNormal = surf.frame.normal;
 
         // What happens if the sampled point is behind the sphere?
         surf.uv = directionToSphereUV(surf.frame.normal);
@@ -56,6 +66,7 @@ public:
 
         Point position = ray(its.t);
         populate(its, position);
+        its.deferred.shape = nullptr;
 
         return true;
     }
@@ -78,6 +89,61 @@ public:
         return areaSample;
     }
 
+    bool canSampleSolidAngle() const override { return true; }
+
+    AreaSample sampleSolidAngle(const Point &origin, Sampler &rng) const override {
+        const float distanceSquared = Vector(origin).lengthSquared();
+        if (distanceSquared <= 1) {
+            // the whole sphere is visible from the inside, so we fall back to area sampling
+            AreaSample sample = sampleArea(rng);
+            sample.pdf = areaToSolidAngle(sample.pdf, origin, sample);
+            return sample;
+        }
+
+        // sample a direction within the cone of directions the sphere subtends
+        const float sin2ThetaMax = 1 / distanceSquared;
+        const float sinThetaMax = std::sqrt(sin2ThetaMax);
+        const float oneMinusCosThetaMax = coneSize(sin2ThetaMax);
+
+        const Point2 rnd = rng.next2D();
+        float sin2Theta, cosTheta;
+        if (sin2ThetaMax < SmallConeThreshold) {
+            // avoid cancellation in 1 - cos(theta) for distant spheres
+            sin2Theta = sin2ThetaMax * rnd.x();
+            cosTheta = std::sqrt(1 - sin2Theta);
+        } else {
+            cosTheta = 1 - rnd.x() * oneMinusCosThetaMax;
+            sin2Theta = 1 - sqr(cosTheta);
+        }
+
+        // find the point on the sphere via the angle alpha at the center of the sphere
+        const float cosAlpha = sin2Theta / sinThetaMax +
+                               cosTheta * safe_sqrt(1 - sin2Theta / sqr(sinThetaMax));
+        const float sinAlpha = safe_sqrt(1 - sqr(cosAlpha));
+        const float phi = 2 * Pi * rnd.y();
+
+        const Vector toCenter = -Vector(origin).normalized();
+        Vector tangent, bitangent;
+        buildOrthonormalBasis(toCenter, tangent, bitangent);
+        const Vector normal = -(sinAlpha * std::cos(phi) * tangent + sinAlpha * std::sin(phi) * bitangent +
+                                cosAlpha * toCenter);
+
+        AreaSample sample;
+        populate(sample, Point(normal));
+        sample.pdf = 1 / (2 * Pi * oneMinusCosThetaMax);
+        return sample;
+    }
+
+    float pdfSolidAngle(const Point &origin, const SurfaceEvent &surface) const override {
+        const float distanceSquared = Vector(origin).lengthSquared();
+        if (distanceSquared <= 1) {
+            SurfaceEvent local;
+            populate(local, surface.position);
+            return areaToSolidAngle(local.pdf, origin, local);
+        }
+        return 1 / (2 * Pi * coneSize(1 / distanceSquared));
+    }
+
     std::string toString() const override {
         return "Sphere[]";
     }
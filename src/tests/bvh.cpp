@@ -0,0 +1,88 @@
+#include <lightwave.hpp>
+
+namespace lightwave {
+
+/**
+ * @brief Tests whether shapes that only differ in their acceleration structure (e.g., binary, 4-wide and 8-wide BVHs,
+ * with and without spatial splits) report the same hits for random rays, for closest hit, occlusion and transmittance
+ * queries.
+ * The first instance serves as reference for all others.
+ */
+class CompareAccelerationStructures : public Test {
+    /// @brief The instances to compare, whose shapes must describe the same geometry.
+    std::vector<ref<Instance>> m_instances;
+    /// @brief The number of random rays traced through every instance.
+    int m_rays;
+
+public:
+    CompareAccelerationStructures(const Properties &properties) {
+        m_instances = properties.getChildren<Instance>();
+        m_rays = properties.get<int>("rays", 1 << 16);
+    }
+
+    void execute() override {
+        if (m_instances.size() < 2) lightwave_throw("need at least two instances to compare");
+
+        const ref<Sampler> rng =
+            std::static_pointer_cast<Sampler>(Registry::create("sampler", "independent", Properties()));
+        rng->seed(0);
+
+        // rays start within and around the reference, so that both inner and outer nodes are traversed
+        const Bounds bounds = m_instances.front()->getBoundingBox();
+        const Vector margin = 0.25f * bounds.diagonal();
+        for (int i = 0; i < m_rays; i++) {
+            const Point2 u = rng->next2D();
+            const Point origin = bounds.min() - margin + (bounds.diagonal() + 2 * margin) *
+                                                             Vector(u.x(), u.y(), rng->next());
+            const Ray ray(origin, squareToUniformSphere(rng->next2D()));
+
+            const Intersection reference = trace(*m_instances.front(), ray, *rng);
+            // a random occlusion distance around the hit, unless it lies too close to the hit to be decided reliably
+            float tMax = (reference ? reference.t : bounds.diagonal().length()) * (0.5f + rng->next());
+            if (reference && std::abs(tMax - reference.t) <= 1e-3f * reference.t) tMax = Infinity;
+
+            for (size_t index = 1; index < m_instances.size(); index++)
+                compare(index, ray, reference, tMax, *rng);
+        }
+        logger(EInfo, "test passed!");
+    }
+
+    std::string toString() const override {
+        return "CompareAccelerationStructures[]";
+    }
+
+private:
+    void compare(size_t index, const Ray &ray, const Intersection &reference, float tMax, Sampler &rng) const {
+        const Intersection its = trace(*m_instances[index], ray, rng);
+        if (bool(its) != bool(reference))
+            lightwave_throw("%s %s the ray from %s towards %s, which the reference %s", m_instances[index]->id(),
+                            its ? "hits" : "misses", ray.origin, ray.direction, reference ? "hits" : "misses");
+        // the same triangles are intersected, only the order of tests differs
+        if (its && std::abs(its.t - reference.t) > 1e-5f * reference.t)
+            lightwave_throw("%s hits the ray from %s towards %s at distance %g, but the reference at %g",
+                            m_instances[index]->id(), ray.origin, ray.direction, its.t, reference.t);
+
+        const bool occluded = m_instances[index]->occluded(ray, tMax, rng);
+        if (occluded != (reference && reference.t < tMax))
+            lightwave_throw("%s reports the ray from %s towards %s as %s within %g, but the reference hits at %g",
+                            m_instances[index]->id(), ray.origin, ray.direction, occluded ? "occluded" : "unoccluded",
+                            tMax, reference.t);
+
+        // opaque shapes either block the ray completely or not at all, no matter how often they are visited
+        const float transmittance = m_instances[index]->transmittance(ray, tMax, rng);
+        if (transmittance != (occluded ? 0 : 1))
+            lightwave_throw("%s reports transmittance %g along the ray from %s towards %s within %g, but is %s",
+                            m_instances[index]->id(), transmittance, ray.origin, ray.direction, tMax,
+                            occluded ? "occluded" : "unoccluded");
+    }
+
+    static Intersection trace(const Instance &instance, const Ray &ray, Sampler &rng) {
+        Intersection its(-ray.direction);
+        instance.intersect(ray, its, rng);
+        return its;
+    }
+};
+
+}
+
+REGISTER_TEST(CompareAccelerationStructures, "bvh_equivalence");
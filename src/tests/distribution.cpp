@@ -0,0 +1,124 @@
+#include <lightwave.hpp>
+
+namespace lightwave {
+
+/**
+ * @brief Tests whether the discrete distributions used for importance sampling report the densities with which they
+ * actually sample, by comparing histograms of stratified samples against the reported probabilities.
+ * @note Includes zero weights, which must never be sampled.
+ */
+class CompareDistributions : public Test {
+    /// @brief The number of stratified samples drawn from each distribution.
+    int m_samples;
+    /// @brief The threshold for the absolute difference between a histogram bin and its probability.
+    float m_threshold;
+
+public:
+    CompareDistributions(const Properties &properties) {
+        m_samples = properties.get<int>("samples", 1 << 20);
+        m_threshold = properties.get<float>("threshold", 1e-3);
+    }
+
+    void execute() override {
+        const std::vector<float> weights = { 0, 1, 3, 0.5f, 0, 2, 8, 0.25f, 0, 1.5f, 0.125f };
+        testAliasTable(weights);
+        testDistribution1D(weights);
+        testDistribution2D(weights, 11, 1);
+        testDistribution2D({ 1, 0, 2, 0.5f, 0, 0, 0, 0, 4, 1, 0.25f, 3, 2, 0, 1 }, 5, 3);
+        logger(EInfo, "test passed!");
+    }
+
+    std::string toString() const override {
+        return "CompareDistributions[]";
+    }
+
+private:
+    static float total(const std::vector<float> &weights) {
+        float sum = 0;
+        for (float weight : weights) sum += weight;
+        return sum;
+    }
+
+    void compare(const char *name, int bin, float frequency, float probability) const {
+        if (!(std::abs(frequency - probability) <= m_threshold))
+            lightwave_throw("%s: bin %d is sampled with frequency %g, but reports probability %g", name, bin,
+                            frequency, probability);
+    }
+
+    void testAliasTable(const std::vector<float> &weights) const {
+        const AliasTable table(weights);
+        const float sum = total(weights);
+
+        std::vector<int> histogram(weights.size(), 0);
+        for (int i = 0; i < m_samples; i++) histogram[table.sample((i + 0.5f) / m_samples)]++;
+
+        for (int bin = 0; bin < table.size(); bin++) {
+            compare("AliasTable", bin, table.probability(bin), weights[bin] / sum);
+            compare("AliasTable", bin, float(histogram[bin]) / m_samples, table.probability(bin));
+            if (weights[bin] == 0 && histogram[bin] > 0)
+                lightwave_throw("AliasTable: bin %d has zero weight, but has been sampled", bin);
+        }
+    }
+
+    void testDistribution1D(const std::vector<float> &function) const {
+        const Distribution1D distribution(function);
+        const int n = distribution.size();
+
+        std::vector<int> histogram(n, 0);
+        for (int i = 0; i < m_samples; i++) {
+            float pdf;
+            int index;
+            const float x = distribution.sample((i + 0.5f) / m_samples, pdf, index);
+            if (int(x * n) != index)
+                lightwave_throw("Distribution1D: sample %g lies outside of the reported interval %d", x, index);
+            if (pdf != distribution.pdf(index))
+                lightwave_throw("Distribution1D: sample in interval %d reports pdf %g instead of %g", index, pdf,
+                                distribution.pdf(index));
+            histogram[index]++;
+        }
+
+        float integral = 0;
+        for (int bin = 0; bin < n; bin++) {
+            integral += distribution.pdf(bin) / n;
+            compare("Distribution1D", bin, float(histogram[bin]) / m_samples, distribution.pdf(bin) / n);
+            if (function[bin] == 0 && histogram[bin] > 0)
+                lightwave_throw("Distribution1D: interval %d has zero density, but has been sampled", bin);
+        }
+        if (std::abs(integral - 1) > 1e-4f)
+            lightwave_throw("Distribution1D: density integrates to %g instead of 1", integral);
+    }
+
+    void testDistribution2D(const std::vector<float> &function, int width, int height) const {
+        const Distribution2D distribution(function, width, height);
+        const int resolution = int(std::sqrt(float(m_samples)));
+
+        std::vector<int> histogram(function.size(), 0);
+        for (int y = 0; y < resolution; y++) {
+            for (int x = 0; x < resolution; x++) {
+                float pdf;
+                const Point2 point =
+                    distribution.sample({ (x + 0.5f) / resolution, (y + 0.5f) / resolution }, pdf);
+                if (pdf != distribution.pdf(point))
+                    lightwave_throw("Distribution2D: sample %s reports pdf %g instead of %g", point, pdf,
+                                    distribution.pdf(point));
+                histogram[int(point.y() * height) * width + int(point.x() * width)]++;
+            }
+        }
+
+        float integral = 0;
+        for (int bin = 0; bin < width * height; bin++) {
+            const Point2 center = { (bin % width + 0.5f) / width, (bin / width + 0.5f) / height };
+            const float probability = distribution.pdf(center) / (width * height);
+            integral += probability;
+            compare("Distribution2D", bin, float(histogram[bin]) / sqr(resolution), probability);
+            if (function[bin] == 0 && histogram[bin] > 0)
+                lightwave_throw("Distribution2D: cell %d has zero density, but has been sampled", bin);
+        }
+        if (std::abs(integral - 1) > 1e-4f)
+            lightwave_throw("Distribution2D: density integrates to %g instead of 1", integral);
+    }
+};
+
+}
+
+REGISTER_TEST(CompareDistributions, "distributions");
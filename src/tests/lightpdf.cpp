@@ -0,0 +1,128 @@
+#include <lightwave.hpp>
+
+namespace lightwave {
+
+/**
+ * @brief Tests whether the solid angle densities of light samples on instances agree with @ref
+ * Instance::pdfSolidAngle for the same point found by tracing a ray towards it (as required for multiple importance
+ * sampling).
+ * Optionally, also tests whether the density integrates to one over all directions in which the instance is seen,
+ * which only holds for shapes whose every point is visible from the origin (e.g., spheres and planar shapes).
+ */
+class CompareLightPdfs : public Test {
+    /// @brief The instances to sample.
+    std::vector<ref<Instance>> m_instances;
+    /// @brief The number of points around each instance from which it is sampled.
+    int m_origins;
+    /// @brief The number of samples per origin.
+    int m_samples;
+    /// @brief Whether to test that the density integrates to one.
+    bool m_normalization;
+    /// @brief The threshold for the relative difference between densities.
+    float m_threshold;
+
+public:
+    CompareLightPdfs(const Properties &properties) {
+        m_instances = properties.getChildren<Instance>();
+        m_origins = properties.get<int>("origins", 16);
+        m_samples = properties.get<int>("samples", 1 << 14);
+        m_normalization = properties.get<bool>("normalization", true);
+        m_threshold = properties.get<float>("threshold", 1e-2);
+    }
+
+    void execute() override {
+        const ref<Sampler> rng =
+            std::static_pointer_cast<Sampler>(Registry::create("sampler", "independent", Properties()));
+        rng->seed(0);
+
+        for (const auto &instance : m_instances) {
+            const Bounds bounds = instance->getBoundingBox();
+            const float radius = bounds.diagonal().length() / 2;
+            for (int i = 0; i < m_origins; i++) {
+                // alternate between origins close to the instance and far away from it
+                const float distance = radius * (i % 2 ? 1.2f : 4.f);
+                const Point origin = bounds.center() + distance * squareToUniformSphere(rng->next2D());
+                testSamples(*instance, origin, *rng);
+                if (m_normalization) testNormalization(*instance, origin, bounds.center(), radius, *rng);
+            }
+        }
+        logger(EInfo, "test passed!");
+    }
+
+    std::string toString() const override {
+        return "CompareLightPdfs[]";
+    }
+
+private:
+    bool similar(float a, float b) const {
+        return std::abs(a - b) <= m_threshold * std::max(std::abs(a), std::abs(b));
+    }
+
+    void testSamples(const Instance &instance, const Point &origin, Sampler &rng) const {
+        for (int i = 0; i < m_samples; i++) {
+            const AreaSample sample = instance.sampleSolidAngle(origin, rng);
+            if (sample.pdf == 0) continue;
+
+            // the point has to be found by a ray towards it, unless the instance occludes it itself (close to the
+            // silhouette, the ray might also hit a neighboring triangle whose density differs)
+            const auto [distance, direction] = (sample.position - origin).lengthAndNormalized();
+            Intersection its = trace(instance, Ray(origin, direction), rng);
+            if (!its || (its.position - sample.position).length() > 1e-4f * distance ||
+                its.geometryNormal.dot(sample.geometryNormal) < 1 - 1e-5f)
+                continue;
+
+            const float hitPdf = instance.pdfSolidAngle(origin, its);
+            if (!similar(sample.pdf, hitPdf))
+                lightwave_throw("%s: sample %s from %s has pdf %g, but the intersection reports %g", instance.id(),
+                                sample.position, origin, sample.pdf, hitPdf);
+        }
+    }
+
+    /// @param center,radius A sphere that bounds the instance, which must not contain the origin.
+    void testNormalization(const Instance &instance, const Point &origin, const Point &center, float radius,
+                           Sampler &rng) const {
+        // integrate the density over all directions by uniformly sampling the cone that contains the instance,
+        // stratified as the density is very peaked when seeing planar shapes at grazing angles
+        const auto [distance, axis] = (center - origin).lengthAndNormalized();
+        const float cosThetaMax = safe_sqrt(1 - sqr(radius / distance));
+        const float conePdf = 1 / (2 * Pi * (1 - cosThetaMax));
+        const Frame frame(axis);
+
+        double integral = 0, squares = 0;
+        const int resolution = 2 * int(std::sqrt(float(m_samples)));
+        const int count = sqr(resolution);
+        for (int i = 0; i < count; i++) {
+            const Point2 jitter = rng.next2D();
+            const Point2 u = { (i % resolution + jitter.x()) / resolution, (i / resolution + jitter.y()) / resolution };
+            const float cosTheta = 1 - u.x() * (1 - cosThetaMax);
+            const float sinTheta = safe_sqrt(1 - sqr(cosTheta));
+            const float phi = 2 * Pi * u.y();
+            const Vector direction =
+                frame.toWorld(Vector(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta)).normalized();
+
+            const Intersection its = trace(instance, Ray(origin, direction), rng);
+            if (!its) continue;
+            const double estimate = instance.pdfSolidAngle(origin, its) / conePdf;
+            integral += estimate;
+            squares += estimate * estimate;
+        }
+        integral /= count;
+
+        // the tolerance accounts for the variance of the estimate, which is large when planar shapes are seen at
+        // grazing angles (an upper bound, as stratification reduces the actual variance)
+        const double stdError = std::sqrt(std::max(squares / count - integral * integral, 0.) / count);
+        if (std::abs(integral - 1) > std::max(0.03, 4 * stdError))
+            lightwave_throw("%s: the density seen from %s integrates to %g instead of 1 (standard error %g)",
+                            instance.id(), origin, integral, stdError);
+    }
+
+    static Intersection trace(const Instance &instance, const Ray &ray, Sampler &rng) {
+        Intersection its(-ray.direction);
+        if (instance.intersect(ray, its, rng) && its.instance) its.instance->computeSurfaceInteraction(ray, its);
+        return its;
+    }
+};
+
+}
+
+REGISTER_TEST(CompareLightPdfs, "light_pdfs");
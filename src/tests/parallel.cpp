@@ -0,0 +1,76 @@
+#include <lightwave.hpp>
+
+#include <atomic>
+
+namespace lightwave {
+
+/**
+ * @brief Tests whether the parallel iteration helpers visit every element of a range exactly once and never
+ * hand out indices outside of it, including ranges that are smaller than a single chunk.
+ */
+class ParallelRanges : public Test {
+public:
+    ParallelRanges(const Properties &properties) {}
+
+    void execute() override {
+        for (int count : { 0, 1, 7, 100, 4095, 4096, 4097, 12345 }) {
+            for (int blockSize : { 1, 64, 4096, 10000 }) {
+                for (int start : { 0, 3 }) {
+                    testChunkedRange(start, start + count, blockSize);
+                }
+            }
+            testParallelFor(count);
+        }
+        logger(EInfo, "test passed!");
+    }
+
+    std::string toString() const override {
+        return "ParallelRanges[]";
+    }
+
+private:
+    void testChunkedRange(int start, int end, int blockSize) const {
+        std::vector<std::atomic<int>> visits(end - start);
+        std::atomic<bool> outOfBounds = false;
+        for_each_parallel(ChunkedRange(start, end, blockSize), [&](Range chunk) {
+            if (chunk.count() > blockSize) outOfBounds = true;
+            for (int i : chunk) {
+                if (i < start || i >= end) {
+                    outOfBounds = true;
+                    continue;
+                }
+                visits[i - start]++;
+            }
+        });
+
+        if (outOfBounds)
+            lightwave_throw("chunk exceeds range [%d, %d) with block size %d", start, end, blockSize);
+        for (int i = 0; i < end - start; i++) {
+            if (visits[i] != 1)
+                lightwave_throw("element %d of range [%d, %d) with block size %d visited %d times", start + i,
+                                start, end, blockSize, visits[i].load());
+        }
+    }
+
+    void testParallelFor(int count) const {
+        std::vector<std::atomic<int>> visits(count);
+        std::atomic<bool> outOfBounds = false;
+        parallel_for(0, count, [&](int i) {
+            if (i < 0 || i >= count) {
+                outOfBounds = true;
+                return;
+            }
+            visits[i]++;
+        });
+
+        if (outOfBounds) lightwave_throw("parallel_for exceeds range [0, %d)", count);
+        for (int i = 0; i < count; i++) {
+            if (visits[i] != 1)
+                lightwave_throw("parallel_for visited element %d of [0, %d) %d times", i, count, visits[i].load());
+        }
+    }
+};
+
+}
+
+REGISTER_TEST(ParallelRanges, "parallel_ranges");
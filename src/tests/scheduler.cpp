@@ -0,0 +1,101 @@
+#include <lightwave.hpp>
+
+#include "../core/scheduler.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace lightwave {
+
+/**
+ * @brief Tests whether the @ref Scheduler runs every executable exactly once and only after all executables it
+ * depends on have finished, for a graph that contains every kind of dependency (read after write, write after write
+ * and write after read) as well as independent executables.
+ */
+class ScheduleExecutables : public Test {
+    /// @brief An executable that only records when it started and finished.
+    class Recorder : public Executable {
+        std::vector<ref<Image>> m_inputs, m_outputs;
+        std::atomic<int> &m_clock;
+
+    public:
+        int started = -1, finished = -1, runs = 0;
+
+        Recorder(std::vector<ref<Image>> inputs, std::vector<ref<Image>> outputs, std::atomic<int> &clock)
+            : m_inputs(std::move(inputs)), m_outputs(std::move(outputs)), m_clock(clock) {}
+
+        void execute() override {
+            started = m_clock++;
+            runs++;
+            // give executables that (incorrectly) run concurrently a chance to overlap
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            finished = m_clock++;
+        }
+
+        std::vector<ref<Image>> inputs() const override { return m_inputs; }
+        std::vector<ref<Image>> outputs() const override { return m_outputs; }
+        std::string toString() const override { return "Recorder[]"; }
+    };
+
+    /// @brief The number of times the graph is scheduled, to catch orderings that only fail occasionally.
+    int m_repetitions;
+
+public:
+    ScheduleExecutables(const Properties &properties) {
+        m_repetitions = properties.get<int>("repetitions", 16);
+    }
+
+    void execute() override {
+        for (int repetition = 0; repetition < m_repetitions; repetition++) testGraph();
+        logger(EInfo, "test passed!");
+    }
+
+    std::string toString() const override {
+        return "ScheduleExecutables[]";
+    }
+
+private:
+    void testGraph() const {
+        const ref<Image> a = std::make_shared<Image>(), b = std::make_shared<Image>(),
+                         c = std::make_shared<Image>(), d = std::make_shared<Image>();
+        std::atomic<int> clock = 0;
+
+        // (inputs, outputs, expected dependencies)
+        const std::vector<std::tuple<std::vector<ref<Image>>, std::vector<ref<Image>>, std::vector<int>>> graph = {
+            { {}, { a }, {} },              // 0
+            { {}, { b }, {} },              // 1
+            { { a }, { c }, { 0 } },        // 2: reads what 0 writes
+            { { a, b }, { d }, { 0, 1 } },  // 3
+            { { c, d }, {}, { 2, 3 } },     // 4
+            { {}, { a }, { 0, 2, 3 } },     // 5: overwrites what 0 wrote and 2 and 3 read
+            { {}, {}, {} },                 // 6: independent of everything
+            { { b }, { b }, { 1, 3 } },     // 7: modifies an image in place
+        };
+
+        std::vector<ref<Recorder>> recorders;
+        std::vector<ref<Executable>> executables;
+        for (const auto &[inputs, outputs, dependencies] : graph) {
+            recorders.push_back(std::make_shared<Recorder>(inputs, outputs, clock));
+            executables.push_back(recorders.back());
+        }
+
+        Scheduler scheduler { executables };
+        scheduler.execute();
+
+        for (int node = 0; node < int(graph.size()); node++) {
+            const Recorder &recorder = *recorders[node];
+            if (recorder.runs != 1)
+                lightwave_throw("executable %d ran %d times instead of once", node, recorder.runs);
+            for (int dependency : std::get<2>(graph[node])) {
+                if (recorder.started < recorders[dependency]->finished)
+                    lightwave_throw("executable %d started before executable %d it depends on finished", node,
+                                    dependency);
+            }
+        }
+    }
+};
+
+}
+
+REGISTER_TEST(ScheduleExecutables, "scheduler");
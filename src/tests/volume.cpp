@@ -0,0 +1,90 @@
+#include <lightwave.hpp>
+
+namespace lightwave {
+
+/**
+ * @brief Tests whether volumes that store the same densities in different ways (e.g., dense grids and sparse bricks
+ * with different encodings) agree in their densities and density bounds, and whether the macro-cells of every volume
+ * bound the densities within them.
+ * The first volume serves as reference for all others.
+ */
+class CompareVolumes : public Test {
+    /// @brief The volumes to compare.
+    std::vector<ref<Volume>> m_volumes;
+    /// @brief The number of random points at which the volumes are evaluated.
+    int m_points;
+    /// @brief The threshold for the absolute difference between densities, relative to the maximum density.
+    float m_threshold;
+
+public:
+    CompareVolumes(const Properties &properties) {
+        m_volumes = properties.getChildren<Volume>();
+        m_points = properties.get<int>("points", 1 << 18);
+        m_threshold = properties.get<float>("threshold", 1e-5);
+    }
+
+    void execute() override {
+        if (m_volumes.size() < 2) lightwave_throw("need at least two volumes to compare");
+
+        const ref<Sampler> rng =
+            std::static_pointer_cast<Sampler>(Registry::create("sampler", "independent", Properties()));
+        rng->seed(0);
+
+        const Volume &reference = *m_volumes.front();
+        const float tolerance = m_threshold * reference.getMaxDensity();
+        for (size_t index = 1; index < m_volumes.size(); index++) {
+            const Volume &volume = *m_volumes[index];
+            if (std::abs(volume.getMinDensity() - reference.getMinDensity()) > tolerance ||
+                std::abs(volume.getMaxDensity() - reference.getMaxDensity()) > tolerance)
+                lightwave_throw("volume %d has densities within [%g, %g], but the reference within [%g, %g]", index,
+                                volume.getMinDensity(), volume.getMaxDensity(), reference.getMinDensity(),
+                                reference.getMaxDensity());
+        }
+
+        for (int i = 0; i < m_points; i++) {
+            // also cover points slightly outside of the grid, where the density vanishes
+            const Point2 u = rng->next2D();
+            const Point point = Point(-1.1f) + 2.2f * Vector(u.x(), u.y(), rng->next());
+
+            const float expected = reference.evaluate(point);
+            for (size_t index = 0; index < m_volumes.size(); index++) {
+                const float density = m_volumes[index]->evaluate(point);
+                if (std::abs(density - expected) > tolerance)
+                    lightwave_throw("volume %d has density %g at %s, but the reference %g", index, density, point,
+                                    expected);
+                testMajorants(index, point, density);
+            }
+        }
+        logger(EInfo, "test passed!");
+    }
+
+    std::string toString() const override {
+        return "CompareVolumes[]";
+    }
+
+private:
+    void testMajorants(size_t index, const Point &point, float density) const {
+        const MajorantGrid *majorants = m_volumes[index]->getMajorantGrid();
+        if (!majorants) return;
+
+        const Bounds bounds = majorants->cellBounds(0, 0, 0);
+        const Vector3i &resolution = majorants->resolution();
+        int cell[3];
+        for (int dim = 0; dim < 3; dim++) {
+            const float coordinate = (point[dim] - bounds.min()[dim]) / bounds.diagonal()[dim];
+            // points on the boundary between cells are bounded by both cells
+            if (coordinate < 0 || coordinate >= resolution[dim] || std::abs(coordinate - std::round(coordinate)) < 1e-4f)
+                return;
+            cell[dim] = int(coordinate);
+        }
+
+        const MajorantGrid::Cell &bound = majorants->cell(cell[0], cell[1], cell[2]);
+        if (density < bound.minDensity * (1 - 1e-5f) || density > bound.maxDensity * (1 + 1e-5f))
+            lightwave_throw("volume %d has density %g at %s, outside of the bounds [%g, %g] of its macro-cell", index,
+                            density, point, bound.minDensity, bound.maxDensity);
+    }
+};
+
+}
+
+REGISTER_TEST(CompareVolumes, "volume_equivalence");
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <lightwave.hpp>
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef LW_OS_WINDOWS
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lightwave {
+
+/// @brief A read-only view of a file that is mapped into memory, so that its pages are only loaded once accessed.
+class MappedFile {
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+#ifdef LW_OS_WINDOWS
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#endif
+
+public:
+    MappedFile(const std::filesystem::path &path) {
+#ifdef LW_OS_WINDOWS
+        m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+            lightwave_throw("could not open file \"%s\"", path.string());
+        LARGE_INTEGER size;
+        GetFileSizeEx(m_file, &size);
+        m_size = size_t(size.QuadPart);
+        if (m_size == 0) return;
+        m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping)
+            m_data = static_cast<const uint8_t *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!m_data) {
+            close();
+            lightwave_throw("could not map file \"%s\"", path.string());
+        }
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            lightwave_throw("could not open file \"%s\"", path.string());
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            lightwave_throw("could not read the size of file \"%s\"", path.string());
+        }
+        m_size = size_t(info.st_size);
+        if (m_size > 0) {
+            void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                ::close(fd);
+                lightwave_throw("could not map file \"%s\"", path.string());
+            }
+            m_data = static_cast<const uint8_t *>(data);
+        }
+        // the mapping stays valid after the descriptor has been closed
+        ::close(fd);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() { close(); }
+
+    const uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    void close() {
+#ifdef LW_OS_WINDOWS
+        if (m_data) UnmapViewOfFile(m_data);
+        if (m_mapping) CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        if (m_data) munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif
+        m_data = nullptr;
+    }
+};
+
+/**
+ * @brief A sparse grid of voxels that is split into bricks of 8x8x8 voxels, of which only bricks that contain non-zero
+ * values are stored. Values are read in place from a memory mapped file (see scripts/convert_bricks.py), which may
+ * store them as 32-bit floats, 16-bit floats or 8-bit values relative to a scale.
+ *
+ * The file starts with a header (see @ref Header), followed by one 32-bit entry per brick (x fastest, then y, then z)
+ * that holds the index of the stored brick or @ref EmptyBrick , followed by the values of all stored bricks (again
+ * x fastest, then y, then z within each brick).
+ */
+class BrickGrid {
+public:
+    /// @brief The number of voxels along each axis of a brick.
+    static constexpr int BrickSize = 8;
+    /// @brief The index entry of bricks that are not stored, i.e., whose values are all zero.
+    static constexpr uint32_t EmptyBrick = 0xFFFFFFFF;
+
+    enum class Encoding : uint32_t {
+        Float32 = 0,
+        Float16 = 1,
+        UInt8 = 2,
+    };
+
+    BrickGrid(const std::filesystem::path &path, float multiplier) : m_file(path) {
+        Header header;
+        if (m_file.size() < sizeof(Header))
+            lightwave_throw("brick volume \"%s\" is truncated", path.string());
+        std::memcpy(&header, m_file.data(), sizeof(Header));
+        if (std::memcmp(header.magic, "LWBV", 4) != 0 || header.version != 1)
+            lightwave_throw("\"%s\" is not a brick volume (or has an unsupported version)", path.string());
+        if (header.brickSize != BrickSize)
+            lightwave_throw("brick volume \"%s\" uses bricks of size %d, only %d is supported", path.string(),
+                            header.brickSize, BrickSize);
+        if (header.encoding > uint32_t(Encoding::UInt8))
+            lightwave_throw("brick volume \"%s\" uses an unknown encoding", path.string());
+
+        m_resolution = Vector3i(header.resolution[0], header.resolution[1], header.resolution[2]);
+        m_bricks = Vector3i((m_resolution.x() + BrickSize - 1) / BrickSize,
+                            (m_resolution.y() + BrickSize - 1) / BrickSize,
+                            (m_resolution.z() + BrickSize - 1) / BrickSize);
+        m_encoding = Encoding(header.encoding);
+        m_scale = header.scale * multiplier;
+        m_minValue = header.minValue * multiplier;
+        m_maxValue = header.maxValue * multiplier;
+        m_occupied = header.brickCount;
+
+        const size_t brickCount = size_t(m_bricks.x()) * m_bricks.y() * m_bricks.z();
+        const size_t valueSize = m_encoding == Encoding::Float32 ? 4 : m_encoding == Encoding::Float16 ? 2 : 1;
+        const size_t indexSize = brickCount * sizeof(uint32_t);
+        if (m_file.size() < sizeof(Header) + indexSize + size_t(m_occupied) * VoxelsPerBrick * valueSize)
+            lightwave_throw("brick volume \"%s\" is truncated", path.string());
+
+        // the header and index are 4 byte aligned, hence all values are naturally aligned
+        m_index = reinterpret_cast<const uint32_t *>(m_file.data() + sizeof(Header));
+        m_values = m_file.data() + sizeof(Header) + indexSize;
+        for (size_t i = 0; i < brickCount; i++) {
+            if (m_index[i] != EmptyBrick && m_index[i] >= m_occupied)
+                lightwave_throw("brick volume \"%s\" references missing bricks", path.string());
+        }
+    }
+
+    const Vector3i &resolution() const { return m_resolution; }
+    /// @brief Returns the number of bricks that are stored.
+    uint32_t occupiedBricks() const { return m_occupied; }
+    /// @brief Returns the number of bricks along each axis.
+    const Vector3i &bricks() const { return m_bricks; }
+    float minValue() const { return m_minValue; }
+    float maxValue() const { return m_maxValue; }
+
+    /// @brief Returns the value of a voxel, which must lie within the resolution of the grid.
+    float value(int x, int y, int z) const {
+        const uint32_t brick = m_index[brickIndex(x / BrickSize, y / BrickSize, z / BrickSize)];
+        if (brick == EmptyBrick) return 0;
+        return decode(size_t(brick) * VoxelsPerBrick + voxelIndex(x % BrickSize, y % BrickSize, z % BrickSize));
+    }
+
+    /**
+     * @brief Gathers the 2x2x2 voxels starting at the given voxel (x fastest, then y, then z), which is what trilinear
+     * filtering needs. Voxels outside of the grid are zero.
+     * @note Most lookups fall within a single brick, which is then only looked up once.
+     */
+    void gather(int x, int y, int z, float (&values)[8]) const {
+        const int lx = x % BrickSize, ly = y % BrickSize, lz = z % BrickSize;
+        if (x >= 0 && y >= 0 && z >= 0 && lx < BrickSize - 1 && ly < BrickSize - 1 && lz < BrickSize - 1 &&
+            x + 1 < m_resolution.x() && y + 1 < m_resolution.y() && z + 1 < m_resolution.z()) {
+            const uint32_t brick = m_index[brickIndex(x / BrickSize, y / BrickSize, z / BrickSize)];
+            if (brick == EmptyBrick) {
+                for (float &value : values) value = 0;
+                return;
+            }
+            const size_t base = size_t(brick) * VoxelsPerBrick + voxelIndex(lx, ly, lz);
+            for (int i = 0; i < 8; i++)
+                values[i] = decode(base + voxelIndex(i & 1, (i >> 1) & 1, i >> 2));
+            return;
+        }
+
+        for (int i = 0; i < 8; i++) {
+            const int vx = x + (i & 1), vy = y + ((i >> 1) & 1), vz = z + (i >> 2);
+            const bool inside = vx >= 0 && vy >= 0 && vz >= 0 && vx < m_resolution.x() && vy < m_resolution.y() &&
+                                vz < m_resolution.z();
+            values[i] = inside ? value(vx, vy, vz) : 0;
+        }
+    }
+
+private:
+    static constexpr int VoxelsPerBrick = BrickSize * BrickSize * BrickSize;
+
+    /// @brief The layout of the header of brick volume files.
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        int32_t resolution[3];
+        uint32_t brickSize;
+        uint32_t encoding;
+        float scale;
+        float minValue;
+        float maxValue;
+        uint32_t brickCount;
+    };
+    static_assert(sizeof(Header) == 44, "the header must not contain padding");
+
+    MappedFile m_file;
+    Vector3i m_resolution;
+    Vector3i m_bricks;
+    Encoding m_encoding;
+    /// @brief The factor that stored values are multiplied with (includes the density multiplier).
+    float m_scale;
+    float m_minValue;
+    float m_maxValue;
+    uint32_t m_occupied;
+    const uint32_t *m_index;
+    const uint8_t *m_values;
+
+    size_t brickIndex(int x, int y, int z) const {
+        return (size_t(z) * m_bricks.y() + y) * m_bricks.x() + x;
+    }
+    static int voxelIndex(int x, int y, int z) {
+        return (z * BrickSize + y) * BrickSize + x;
+    }
+
+    float decode(size_t index) const {
+        switch (m_encoding) {
+        case Encoding::Float32:
+            return reinterpret_cast<const float *>(m_values)[index] * m_scale;
+        case Encoding::Float16:
+            return halfToFloat(reinterpret_cast<const uint16_t *>(m_values)[index]) * m_scale;
+        default:
+            return m_values[index] * m_scale;
+        }
+    }
+
+    /// @brief Converts an IEEE 754 half precision float to single precision.
+    static float halfToFloat(uint16_t half) {
+        const uint32_t sign = uint32_t(half & 0x8000) << 16;
+        uint32_t exponent = (half >> 10) & 0x1F;
+        uint32_t mantissa = half & 0x3FF;
+
+        uint32_t bits;
+        if (exponent == 0x1F) {
+            // infinity or NaN
+            bits = sign | 0x7F800000 | (mantissa << 13);
+        } else if (exponent == 0) {
+            if (mantissa == 0) {
+                bits = sign;
+            } else {
+                // subnormal, renormalize it
+                exponent = 127 - 14;
+                while (!(mantissa & 0x400)) {
+                    mantissa <<= 1;
+                    exponent--;
+                }
+                bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+            }
+        } else {
+            bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+        }
+
+        float result;
+        std::memcpy(&result, &bits, sizeof(float));
+        return result;
+    }
+};
+
+}
@@ -15,6 +15,13 @@ public:
 
     float getMaxDensity() const override { return m_value; }
 
+    float getMinDensity() const override { return m_value; }
+
+    float transmittance(const Ray &localRay, float tStart, float tEnd, float scaleFactor,
+                        Sampler &rng) const override {
+        return std::exp(-m_value * (tEnd - tStart) / scaleFactor);
+    }
+
     std::string toString() const override {
         return tfm::format("ConstantVolume[\n"
                            "  value = %s\n"
@@ -1,9 +1,15 @@
 #include <lightwave.hpp>
 #include <fstream>
+#include <memory>
+
+#include "bricks.hpp"
 
 namespace lightwave {
 
-/// @brief Volume loaded from a grid of float densities
+/**
+ * @brief Volume loaded from a grid of float densities, either stored densely (.vol) or as sparse bricks that are
+ * mapped into memory (.bvol, see @ref BrickGrid ).
+ */
 class GridVolume : public Volume {
     enum class FilterMode {
         Nearest,
@@ -12,8 +18,13 @@ class GridVolume : public Volume {
     
     Vector3i m_resolution;
     std::vector<float> m_grid;
+    /// @brief Sparse storage of the grid (null if the grid is stored densely in m_grid)
+    std::unique_ptr<BrickGrid> m_bricks;
     float m_max_value; // Maximum density along the volume 
+    float m_min_value; // Minimum density along the volume
     FilterMode m_filter;
+    /// @brief Local density bounds for tracking (null if disabled)
+    std::unique_ptr<MajorantGrid> m_majorants;
 
 public:
     GridVolume(const Properties &properties) {
@@ -29,32 +40,23 @@ public:
 
         // TODO: Use filepath instead of string
         auto path = properties.get<std::string>("filename");
-        std::ifstream input(path, std::ios::binary);
-
-        if (!input.is_open()) {
-            std::cerr << "Error opening the file!" << std::endl;
-            exit(1);
+        if (std::filesystem::path(path).extension() == ".bvol") {
+            m_bricks = std::make_unique<BrickGrid>(path, multiplier);
+            m_resolution = m_bricks->resolution();
+            m_max_value = m_bricks->maxValue();
+            m_min_value = m_bricks->minValue();
+            logger(EInfo, "mapped brick volume \"%s\" (%d x %d x %d, %d of %d bricks occupied)", path,
+                   m_resolution.x(), m_resolution.y(), m_resolution.z(), m_bricks->occupiedBricks(),
+                   m_bricks->bricks().product());
+        } else {
+            loadDense(path, multiplier);
         }
 
-        float fx, fy, fz;
-        input.read(reinterpret_cast<char*>(&fx), sizeof(float));
-        input.read(reinterpret_cast<char*>(&fy), sizeof(float));
-        input.read(reinterpret_cast<char*>(&fz), sizeof(float));
-        int x = fx, y = fy, z = fz;
-
-        logger(EInfo, "loading volume \"%s\" (%d x %d x %d)", path, x, y, z);
-        m_resolution = Vector3i(x, y, z);
-        int voxelCount = x * y * z;
-        m_grid.resize(voxelCount);
-        m_max_value = 0.f;
-        for (int i = 0; i < voxelCount; i++) {
-            float v;
-            input.read(reinterpret_cast<char*>(&v), sizeof(float));
-            m_grid[i] = v * multiplier;
-            if (m_grid[i] > m_max_value)
-                m_max_value = m_grid[i];
+        // Number of voxels along each axis of a macro-cell (0 disables macro-cells)
+        const int macroCellSize = properties.get<int>("macroCellSize", 8);
+        if (macroCellSize > 0 && m_resolution.product() > 0) {
+            buildMajorantGrid(macroCellSize);
         }
-        logger(EInfo, "loaded volume with %d voxels", voxelCount);
     }
 
     float evaluate(const Point &pos) const override {
@@ -72,14 +74,22 @@ public:
         }
 
         const Point fc = {dc.x() - x, dc.y() - y, dc.z() - z};
-        const float v000 = getValueAt(x, y, z);
-        const float v001 = getValueAt(x, y, z + 1);
-        const float v010 = getValueAt(x, y + 1, z);
-        const float v011 = getValueAt(x, y + 1, z + 1);
-        const float v100 = getValueAt(x + 1, y, z);
-        const float v101 = getValueAt(x + 1, y, z + 1);
-        const float v110 = getValueAt(x + 1, y + 1, z);
-        const float v111 = getValueAt(x + 1, y + 1, z + 1);
+        // Corners of the cell, indexed by their offsets (x fastest, then y, then z)
+        float corners[8];
+        if (m_bricks) {
+            m_bricks->gather(x, y, z, corners);
+        } else {
+            for (int i = 0; i < 8; i++)
+                corners[i] = getValueAt(x + (i & 1), y + ((i >> 1) & 1), z + (i >> 2));
+        }
+        const float v000 = corners[0];
+        const float v001 = corners[4];
+        const float v010 = corners[2];
+        const float v011 = corners[6];
+        const float v100 = corners[1];
+        const float v101 = corners[5];
+        const float v110 = corners[3];
+        const float v111 = corners[7];
 
         const float v00 = lerp(v000, v100, fc.x());
         const float v01 = lerp(v001, v101, fc.x());
@@ -96,6 +106,10 @@ public:
 
     float getMaxDensity() const override { return m_max_value; }
 
+    float getMinDensity() const override { return m_min_value; }
+
+    const MajorantGrid *getMajorantGrid() const override { return m_majorants.get(); }
+
     std::string toString() const override {
         return tfm::format("GridVolume[\n"
                            "  max_value = %s\n"
@@ -103,10 +117,93 @@ public:
                            indent(m_max_value));
     }
 private:
+    /// @brief Reads a densely stored grid of floats (.vol), whose resolution is stored as three floats in front.
+    void loadDense(const std::string &path, float multiplier) {
+        std::ifstream input(path, std::ios::binary);
+
+        if (!input.is_open()) {
+            std::cerr << "Error opening the file!" << std::endl;
+            exit(1);
+        }
+
+        float fx, fy, fz;
+        input.read(reinterpret_cast<char*>(&fx), sizeof(float));
+        input.read(reinterpret_cast<char*>(&fy), sizeof(float));
+        input.read(reinterpret_cast<char*>(&fz), sizeof(float));
+        int x = fx, y = fy, z = fz;
+
+        logger(EInfo, "loading volume \"%s\" (%d x %d x %d)", path, x, y, z);
+        m_resolution = Vector3i(x, y, z);
+        int voxelCount = x * y * z;
+        m_grid.resize(voxelCount);
+        m_max_value = 0.f;
+        m_min_value = voxelCount > 0 ? Infinity : 0.f;
+        for (int i = 0; i < voxelCount; i++) {
+            float v;
+            input.read(reinterpret_cast<char*>(&v), sizeof(float));
+            m_grid[i] = v * multiplier;
+            if (m_grid[i] > m_max_value)
+                m_max_value = m_grid[i];
+            if (m_grid[i] < m_min_value)
+                m_min_value = m_grid[i];
+        }
+        logger(EInfo, "loaded volume with %d voxels", voxelCount);
+    }
+
+    /// @brief Computes the density bounds of macro-cells spanning roughly the given number of voxels along each axis.
+    void buildMajorantGrid(int macroCellSize) {
+        const Vector3i cells(
+            (m_resolution.x() + macroCellSize - 1) / macroCellSize,
+            (m_resolution.y() + macroCellSize - 1) / macroCellSize,
+            (m_resolution.z() + macroCellSize - 1) / macroCellSize);
+        m_majorants = std::make_unique<MajorantGrid>(Bounds(Point(-1), Point(1)), cells);
+
+        int emptyCells = 0;
+        for (int z = 0; z < cells.z(); z++) {
+            for (int y = 0; y < cells.y(); y++) {
+                for (int x = 0; x < cells.x(); x++) {
+                    // Find the voxels that the filter can access within the cell (see evaluate), with one voxel of
+                    // padding on either side to be robust against rounding
+                    const Bounds bounds = m_majorants->cellBounds(x, y, z);
+                    int first[3], last[3];
+                    for (int dim = 0; dim < 3; dim++) {
+                        float lo = (bounds.min()[dim] * 0.5f + 0.5f) * m_resolution[dim];
+                        float hi = (bounds.max()[dim] * 0.5f + 0.5f) * m_resolution[dim];
+                        if (dim == 1) {
+                            // the grid is stored upside down
+                            std::swap(lo, hi);
+                            lo = m_resolution[dim] - lo;
+                            hi = m_resolution[dim] - hi;
+                        }
+                        first[dim] = int(floor(lo)) - 1;
+                        last[dim] = int(floor(hi)) + 1;
+                    }
+
+                    MajorantGrid::Cell &cell = m_majorants->cell(x, y, z);
+                    cell = { Infinity, 0.f };
+                    for (int vz = first[2]; vz <= last[2]; vz++) {
+                        for (int vy = first[1]; vy <= last[1]; vy++) {
+                            for (int vx = first[0]; vx <= last[0]; vx++) {
+                                const float value = getValueAt(vx, vy, vz);
+                                cell.minDensity = std::min(cell.minDensity, value);
+                                cell.maxDensity = std::max(cell.maxDensity, value);
+                            }
+                        }
+                    }
+                    if (cell.maxDensity == 0) emptyCells++;
+                }
+            }
+        }
+        logger(EInfo, "built %d x %d x %d macro-cells (%d empty)", cells.x(), cells.y(), cells.z(), emptyCells);
+    }
+
     float getValueAt(int x, int y, int z) const {
-        if (x > m_resolution.x() - 1 || y > m_resolution.y() - 1 || z > m_resolution.z() - 1) {
+        if (x < 0 || y < 0 || z < 0 || x > m_resolution.x() - 1 || y > m_resolution.y() - 1 || z > m_resolution.z() - 1) {
             return 0.f;
         }
+        if (m_bricks) {
+            return m_bricks->value(x, y, z);
+        }
         return m_grid[(z * m_resolution.x() * m_resolution.y()) + (y * m_resolution.x()) + x];
     }
 };